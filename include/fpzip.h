@@ -74,6 +74,13 @@
 ** used, then the FPZ fields must be set by the caller in both read and
 ** write mode.
 **
+** Streams written with default options have the same header as earlier
+** versions of fpzip.  Any other option (chunking, lanes, coder, model,
+** bypass, predictor, batches, or 64-bit dimensions) selects an extended
+** header, which starts with a word of flags listing the options present.
+** A reader that does not know one of these options rejects the stream with
+** fpzipErrorBadVersion.
+**
 ** A single compressed stream may store multiple contiguous fields (e.g.,
 ** for multiple arrays with the same dimensions that represent different
 ** variables).  Similarly, a stream may store multiple arrays of different
@@ -81,10 +88,180 @@
 ** the caller to interleave read/write calls that perform (de)compression
 ** of floating-point data with read/write calls of header data.
 **
+** By default, each field is compressed as a single sequential stream.  For
+** large arrays, the stream may optionally be partitioned into chunks of at
+** most cx * cy * cz samples (e.g., z-slabs or bricks) by setting one or more
+** of the FPZ chunk dimensions before writing the header.  Each chunk is
+** predicted and entropy coded independently of all others and is preceded
+** in the stream by a table of chunk sizes.  When fpzip is built with OpenMP
+** support, chunks are (de)compressed in parallel using the number of threads
+** given by FPZ.threads.  The compressed stream does not depend on the number
+** of threads used.  Chunking comes at a modest loss in compression ratio and
+** requires an fpzip 1.4 or later reader.
+**
+** Because chunks never span multiple fields, a single field of a chunked
+** multi-field stream can be decompressed via fpzip_read_field without
+** decoding any other field.  Setting cz = nz yields one chunk per field.
+** For unchunked streams, fpzip_read_field must decode all fields.
+**
+** Similarly, fpzip_read_subvolume decompresses an axis-aligned box of
+** samples from each field, decoding only those chunks that overlap the box.
+** Choosing bricks (e.g., 32 * 32 * 32) over slabs thus allows efficient
+** random access to small subvolumes.  For unchunked streams, each field is
+** decoded in its entirety and then cropped.
+**
+** Unchunked streams are compressed sequentially by default.  When FPZ.threads
+** is explicitly set to two or more and multiple processors are available,
+** prediction and entropy coding of large arrays are instead overlapped by
+** running them on two threads.  The output is identical to that of
+** sequential compression.
+**
+** On x86-64, the prediction and mapping kernels used by the compressor are
+** built for several SIMD instruction sets (SSE4.2, AVX2, AVX-512), and the
+** most capable one supported by the processor is selected at startup.  All
+** variants produce identical streams.  Setting the environment variable
+** FPZIP_CPU to baseline, sse4.2, or avx2 restricts this choice, e.g., for
+** testing.
+**
+** Decompression speed is limited by the long chain of dependent operations
+** needed to decode each sample.  Setting FPZ.lanes to N > 1 distributes the
+** samples of each field (or chunk) round-robin over N independently range
+** coded lanes, which allows the processor to overlap the decoding of N
+** consecutive samples.  Four or eight lanes typically work best.  Each lane
+** adapts its own probability model, which slightly reduces compression.
+** Multi-lane streams require an fpzip 1.4 or later reader.
+**
+** By default, symbols are entropy coded using an adaptive range coder.
+** Setting FPZ.coder to FPZIP_CODER_RANS selects an adaptive rANS coder
+** instead, which compresses equally well but decodes substantially faster
+** because it requires no division.  rANS encoding is slightly slower, as
+** symbols must be buffered and coded in reverse.  The coder is recorded in
+** the header; rANS coded streams require an fpzip 1.4 or later reader.
+**
+** Either coder by default adapts its probability model to the symbols
+** coded so far, which must be updated after every symbol.  Setting FPZ.model
+** to FPZIP_MODEL_STATIC instead gathers symbol statistics in an additional
+** pass over each field (or chunk) and stores a compact frequency table at
+** the start of each lane.  The model then remains fixed, which speeds up
+** decoding at the expense of slower compression and a slight loss in ratio
+** on small arrays.  Streams with semi-static models require an fpzip 1.4 or
+** later reader.
+**
+** Setting FPZ.model to FPZIP_MODEL_CONTEXT keeps several adaptive models
+** per lane and selects one for each sample based on how well its left,
+** below, and behind neighbors were predicted.  Separating smooth from
+** turbulent regions this way improves compression on data with varying
+** local activity at a small cost in speed.  Unchunked streams using this
+** model are compressed on a single thread.
+**
+** Most of the compressed output at high precision consists of the low
+** bits of prediction residuals, which are essentially random.  Setting
+** FPZ.bypass to one stores these bits uncoded in a separate bit stream per
+** lane rather than passing them through the entropy coder, which speeds up
+** both compression and decompression at a negligible cost in compression.
+** Streams with bypassed bits require an fpzip 1.4 or later reader.
+**
+** Each sample is by default predicted from its seven previously coded
+** neighbors in a 2 * 2 * 2 cube (the 3D Lorenzo predictor), which suits
+** data that is smooth along all three axes.  Setting FPZ.predictor to
+** FPZIP_PREDICTOR_ADAPTIVE instead selects, for each row of nx samples,
+** whichever of the 3D Lorenzo, 2D Lorenzo (within the current slice),
+** previous-sample, and linear-along-x predictors leaves the smallest
+** residuals on a subset of the row's samples.  The choice costs two bits
+** per row and improves compression of noisy data and of data that is
+** smooth along only some axes.  Unchunked streams using adaptive
+** prediction are compressed on a single thread, and require an fpzip 1.4
+** or later reader.
+**
+** fpzip_read_from_path maps a compressed file into memory, where the
+** platform supports it, and decodes directly from the mapping without
+** copying it through stdio buffers.  fpzip_read_from_mmap similarly reads
+** from a buffer whose size is known, such as a file mapped by the caller.
+** In both cases, no byte past the end of the buffer is read, and the
+** byte counts returned by the fpzip_read functions are exact, which
+** allows locating any data that follows in the same file.
+**
+** fpzip_write_to_callback passes compressed output to a user function in
+** large blocks (64 KB by default) rather than writing it to a file.  When the
+** compressed size is not known in advance, fpzip_write_to_memory instead
+** writes to a buffer that grows as needed; fpzip_write_close_memory then
+** transfers ownership of this buffer, which must be freed by the caller.
+**
+** fpzip_compress_bound returns the largest number of bytes that
+** fpzip_write_header and fpzip_write may output for an array with the
+** given meta data and coding options, whatever its values.  A buffer of
+** this size passed to fpzip_write_to_buffer is therefore never overrun.
+** The bound reflects the worst case of the entropy coders rather than
+** the few percent by which incompressible data typically expands, and
+** is largest for range coded streams: about 2.25 times the uncompressed
+** size for full-precision floats and 1.9 times for doubles.  rANS coding
+** lowers it to about 1.5 and 1.25 times, respectively.
+**
+** Arrays too large to hold in memory may be compressed a few z slices
+** (nx * ny samples each) at a time.  After fpzip_write_header, call
+** fpzip_write_begin, then fpzip_write_slices for consecutive slices in
+** the order that fpzip_write visits them (all slices of the first field,
+** then the second field, and so on), and finally fpzip_write_end once all
+** nz * nf slices have been written.  Prediction and coding state carries
+** over between calls, and the stream is identical to one written by a
+** single call to fpzip_write.  The compressor retains only two slices of
+** its own, but streams with multiple lanes, rANS coding, or bypassed bits
+** are buffered in compressed form until the end of each field.  Chunked
+** streams and semi-static models require the whole array and are not
+** supported, and fpzip_write may not be called in between.
+**
+** Likewise, after fpzip_read_header, fpzip_read_slices decompresses the
+** next few z slices of an unchunked array per call, in the same order,
+** using memory proportional to one slice rather than the whole array.
+** Once all nz * nf slices have been read, the stream is positioned at any
+** data that follows, e.g., another header.  Streams with multiple lanes,
+** rANS coding, or bypassed bits are fetched in compressed form one field
+** at a time.  Any unchunked stream may be read this way, whether or not
+** it was written slice by slice.  Once the first slice has been read,
+** fpzip_read, fpzip_read_field, and fpzip_read_subvolume fail until the
+** next header is read.
+**
+** Compressing many small arrays, e.g., the blocks of an adaptive mesh,
+** is dominated by allocating and initializing streams, prediction buffers,
+** and probability models.  A context created by fpzip_context_create
+** avoids this: a memory stream obtained from fpzip_context_write_to_buffer
+** or fpzip_context_read_from_buffer is kept by the context when closed
+** and recycled by the next such call.  Along with the stream, its coders
+** and the state of its most recent field are kept, and are reset in place
+** when the next array has the same type, precision, nx, ny, and coding
+** options; arrays of other shapes are (de)compressed correctly but without
+** reuse.  The compressed stream is the same with or without a context.  A
+** context may be used by only one thread at a time, and must not be freed
+** before all of its streams have been closed.  Chunks of chunked streams
+** are (de)compressed without reuse.
+**
+** fpzip_write_batch compresses many arrays, each described by the meta
+** data (type, prec, nx, ny, nz, nf) of an fpzip_batch_item, to a single
+** stream with one header that holds the coding options of the stream
+** handle.  Meta data equal to that of the previous array is stored in a
+** single bit.  Consecutive arrays are grouped into segments of at least
+** 64K samples that share an entropy coder, and whose adaptive models carry
+** over from one array to the next when consecutive arrays have the same
+** type, precision, nx, and ny.  Segments are preceded by a compact table of
+** their sizes and are (de)compressed in parallel when fpzip is built with
+** OpenMP support.  To decompress, call fpzip_read_batch_header to obtain
+** the number of arrays and their meta data (this may be repeated, e.g.,
+** first with n = 0 to size the array of items), then fpzip_read_batch.
+** Batches cannot be chunked and require an fpzip 1.4 or later reader.
+**
+** Array dimensions and element counts are 64 bits wide on 64-bit
+** platforms, so a single stream may hold arrays of more than 2^32 samples.
+** Dimensions that fit in 32 bits are stored in the header as before, which
+** earlier readers understand; larger ones select a header with 64-bit
+** dimensions that requires an fpzip 1.4 or later reader.
+**
 ** The return value of each function should be checked in case invalid
 ** arguments are passed or a run-time error occurs.  In this case, the
 ** variable fpzip_errno is set and can be examined to determine the cause
-** of the error.
+** of the error.  Like errno, fpzip_errno is local to the calling thread,
+** so different threads may safely operate on different streams at the
+** same time.  Languages that cannot expand the fpzip_errno macro may
+** call fpzip_errno_location instead.
 **
 ** fpzip is distributed as Open Source under a BSD-3 license.  The core
 ** library is written in C++ and applications need to be linked with a C++
@@ -127,7 +304,7 @@
 
 /* library version information */
 #define FPZIP_VERSION_MAJOR 1 /* library major version number */
-#define FPZIP_VERSION_MINOR 3 /* library minor version number */
+#define FPZIP_VERSION_MINOR 4 /* library minor version number */
 #define FPZIP_VERSION_PATCH 0 /* library patch version number */
 
 /* library version number (see also fpzip_codec_version) */
@@ -154,6 +331,16 @@
 #define FPZIP_TYPE_FLOAT  0 /* single-precision data (see FPZ.type) */
 #define FPZIP_TYPE_DOUBLE 1 /* double-precision data */
 
+#define FPZIP_CODER_RANGE 0 /* adaptive range coder (see FPZ.coder) */
+#define FPZIP_CODER_RANS  1 /* adaptive rANS coder */
+
+#define FPZIP_MODEL_ADAPTIVE 0 /* adaptive probability model (see FPZ.model) */
+#define FPZIP_MODEL_STATIC   1 /* semi-static model stored in stream */
+#define FPZIP_MODEL_CONTEXT  2 /* adaptive models selected by local context */
+
+#define FPZIP_PREDICTOR_LORENZO  0 /* 3D Lorenzo predictor (see FPZ.predictor) */
+#define FPZIP_PREDICTOR_ADAPTIVE 1 /* predictor selected per row */
+
 #ifdef __cplusplus
 #include <cstdio>
 extern "C" {
@@ -161,22 +348,58 @@ extern "C" {
 #include <stdio.h>
 #endif
 
+/* reusable (de)compression state (see fpzip_context_create) */
+typedef struct fpzip_context fpzip_context;
+
 /* array meta data and stream handle */
 typedef struct {
-  int type; /* single (0) or double (1) precision */
-  int prec; /* number of bits of precision (zero = full) */
-  int nx;   /* number of x samples */
-  int ny;   /* number of y samples */
-  int nz;   /* number of z samples */
-  int nf;   /* number of fields */
+  int    type;      /* single (0) or double (1) precision */
+  int    prec;      /* number of bits of precision (zero = full) */
+  size_t nx;        /* number of x samples */
+  size_t ny;        /* number of y samples */
+  size_t nz;        /* number of z samples */
+  size_t nf;        /* number of fields */
+  int    cx;        /* number of x samples per chunk (zero = nx or unchunked) */
+  int    cy;        /* number of y samples per chunk (zero = ny or unchunked) */
+  int    cz;        /* number of z samples per chunk (zero = nz or unchunked) */
+  int    lanes;     /* number of entropy coder lanes (zero = one; at most 255) */
+  int    coder;     /* entropy coder (range or rANS) */
+  int    model;     /* probability model (adaptive, semi-static, or context) */
+  int    bypass;    /* store low bits of residuals uncoded (0 or 1) */
+  int    predictor; /* predictor (Lorenzo or adaptive) */
+  int    threads;   /* number of threads (zero = default); not stored in stream */
 } FPZ;
 
+/* array in a batch */
+typedef struct {
+  FPZ   fpz;  /* meta data (only type, prec, nx, ny, nz, and nf are used) */
+  void* data; /* uncompressed floating-point data (only read when compressing) */
+} fpzip_batch_item;
+
+/* user function that consumes compressed output data; returns number of
+   bytes consumed (less than size = error) */
+typedef size_t (*fpzip_write_func)(
+  void*       ctx,    /* user data passed to fpzip_write_to_callback */
+  const void* data,   /* compressed data */
+  size_t      size    /* number of bytes in data */
+);
+
 /* public data */
 extern_ const unsigned int fpzip_codec_version;   /* codec version FPZIP_CODEC */
 extern_ const unsigned int fpzip_library_version; /* library version FPZIP_VERSION */
 extern_ const char* const fpzip_version_string;   /* verbose version string */
 extern_ const unsigned int fpzip_data_model;      /* encoding of data model */
 
+/* allocate context for recycling memory streams and their coding state */
+fpzip_context*        /* context */
+fpzip_context_create(void);
+
+/* deallocate context once all of its streams have been closed */
+void
+fpzip_context_free(
+  fpzip_context* ctx  /* context */
+);
+
 /* associate file with compressed input stream */
 FPZ*                  /* compressed stream */
 fpzip_read_from_file(
@@ -189,6 +412,26 @@ fpzip_read_from_buffer(
   const void* buffer  /* pointer to compressed input data */
 );
 
+/* map file into memory and associate it with compressed input stream */
+FPZ*                  /* compressed stream (null = error) */
+fpzip_read_from_path(
+  const char* path    /* path of compressed input file */
+);
+
+/* associate memory buffer of known size with compressed input stream */
+FPZ*                  /* compressed stream */
+fpzip_read_from_mmap(
+  const void* buffer, /* pointer to compressed input data, e.g., mapped file */
+  size_t size         /* size of buffer in bytes */
+);
+
+/* associate memory buffer with input stream recycled by context */
+FPZ*                  /* compressed stream (null = error) */
+fpzip_context_read_from_buffer(
+  fpzip_context* ctx, /* context */
+  const void* buffer  /* pointer to compressed input data */
+);
+
 /* read FPZ meta data (use only if previously written) */
 int                   /* nonzero upon success */
 fpzip_read_header(
@@ -202,7 +445,52 @@ fpzip_read(
   void* data          /* uncompressed floating-point data */
 );
 
-/* close input stream and deallocate fpz */
+/* decompress a single field of a multi-field array */
+size_t                /* number of compressed bytes read (zero = error) */
+fpzip_read_field(
+  FPZ*   fpz,         /* compressed stream */
+  size_t k,           /* index of field to read (0 <= k < nf) */
+  void*  data         /* uncompressed floating-point data for field k */
+);
+
+/* decompress a box of samples from each field of a multi-field array */
+size_t                /* number of compressed bytes read (zero = error) */
+fpzip_read_subvolume(
+  FPZ*   fpz,         /* compressed stream */
+  size_t x0,          /* first x sample of box */
+  size_t y0,          /* first y sample of box */
+  size_t z0,          /* first z sample of box */
+  size_t nx,          /* number of x samples in box */
+  size_t ny,          /* number of y samples in box */
+  size_t nz,          /* number of z samples in box */
+  void*  data         /* uncompressed data (nx * ny * nz * nf values) */
+);
+
+/* decompress next z slices of array */
+size_t                /* number of compressed bytes read so far (zero = error) */
+fpzip_read_slices(
+  FPZ*  fpz,          /* compressed stream */
+  void* data,         /* uncompressed data (nx * ny * nslices values) */
+  int   nslices       /* number of slices */
+);
+
+/* read meta data of batch and set that of its first n arrays */
+int                   /* number of arrays in batch (negative = error) */
+fpzip_read_batch_header(
+  FPZ*              fpz,  /* compressed stream */
+  fpzip_batch_item* item, /* arrays whose meta data to set */
+  int               n     /* number of items */
+);
+
+/* decompress batch of arrays (after fpzip_read_batch_header) */
+size_t                /* number of compressed bytes read (zero = error) */
+fpzip_read_batch(
+  FPZ*              fpz,  /* compressed stream */
+  fpzip_batch_item* item, /* arrays to decompress to */
+  int               n     /* number of arrays in batch */
+);
+
+/* close input stream and deallocate fpz (or return it to its context) */
 void
 fpzip_read_close(
   FPZ* fpz            /* compressed stream */
@@ -221,12 +509,37 @@ fpzip_write_to_buffer(
   size_t size         /* size of allocated storage for buffer */
 );
 
+/* associate user function with compressed output stream */
+FPZ*                  /* compressed stream */
+fpzip_write_to_callback(
+  fpzip_write_func func, /* function that consumes compressed output data */
+  void*            ctx   /* user data passed to func */
+);
+
+/* associate growable memory buffer with compressed output stream */
+FPZ*                  /* compressed stream */
+fpzip_write_to_memory(void);
+
+/* associate memory buffer with output stream recycled by context */
+FPZ*                  /* compressed stream (null = error) */
+fpzip_context_write_to_buffer(
+  fpzip_context* ctx, /* context */
+  void*  buffer,      /* pointer to compressed output data */
+  size_t size         /* size of allocated storage for buffer */
+);
+
 /* write FPZ meta data */
 int                   /* nonzero upon success */
 fpzip_write_header(
   FPZ* fpz            /* compressed stream */
 );
 
+/* maximum size of compressed header and array with given meta data */
+size_t                /* upper bound on number of compressed bytes (zero = error) */
+fpzip_compress_bound(
+  const FPZ* fpz      /* meta data of array to compress */
+);
+
 /* compress array */
 size_t                /* number of compressed bytes written (zero = error) */
 fpzip_write(
@@ -234,12 +547,47 @@ fpzip_write(
   const void* data    /* uncompressed floating-point data */
 );
 
-/* close output stream and deallocate fpz */
+/* compress batch of arrays along with their meta data */
+size_t                /* number of compressed bytes written (zero = error) */
+fpzip_write_batch(
+  FPZ*                    fpz,  /* compressed stream with coding options */
+  const fpzip_batch_item* item, /* arrays to compress */
+  int                     n     /* number of arrays */
+);
+
+/* begin compressing array slice by slice (after fpzip_write_header) */
+int                   /* nonzero upon success */
+fpzip_write_begin(
+  FPZ* fpz            /* compressed stream */
+);
+
+/* compress next z slices of array */
+int                   /* nonzero upon success */
+fpzip_write_slices(
+  FPZ*        fpz,    /* compressed stream */
+  const void* data,   /* uncompressed data (nx * ny * nslices values) */
+  int         nslices /* number of slices */
+);
+
+/* finish compressing array once all nz * nf slices have been written */
+size_t                /* number of compressed bytes written (zero = error) */
+fpzip_write_end(
+  FPZ* fpz            /* compressed stream */
+);
+
+/* close output stream and deallocate fpz (or return it to its context) */
 void
 fpzip_write_close(
   FPZ* fpz            /* compressed stream */
 );
 
+/* close stream created by fpzip_write_to_memory and deallocate fpz */
+void*                 /* compressed data to be freed by caller (null = error) */
+fpzip_write_close_memory(
+  FPZ*    fpz,        /* compressed stream */
+  size_t* size        /* number of compressed bytes */
+);
+
 /*
 ** Error codes.
 */
@@ -252,10 +600,16 @@ typedef enum {
   fpzipErrorBadVersion     = 4, /* fpz format version not supported */
   fpzipErrorBadPrecision   = 5, /* precision not supported */
   fpzipErrorBufferOverflow = 6, /* compressed buffer overflow */
-  fpzipErrorInternal       = 7  /* exception thrown */
+  fpzipErrorInternal       = 7, /* exception thrown */
+  fpzipErrorBadArgument    = 8  /* invalid function argument */
 } fpzipError;
 
-extern_ fpzipError fpzip_errno; /* error code */
+/* address of error code of calling thread */
+fpzipError*
+fpzip_errno_location(void);
+
+#define fpzip_errno (*fpzip_errno_location()) /* error code */
+
 extern_ const char* const fpzip_errstr[]; /* error message indexed by fpzip_errno */
 
 #ifdef __cplusplus
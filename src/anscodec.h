@@ -0,0 +1,7 @@
+#ifndef ANS_CODEC_H
+#define ANS_CODEC_H
+
+#define ANS_LOW     (1u << 23) // lower bound on normalized coder state
+#define ANS_SEGMENT 0x4000u    // number of symbols per coded segment
+
+#endif
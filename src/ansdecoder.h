@@ -0,0 +1,49 @@
+#ifndef ANS_DECODER_H
+#define ANS_DECODER_H
+
+#include "types.h"
+#include "rcmodel.h"
+#include "anscodec.h"
+
+// Byte-wise rANS decoder for a memory buffer holding the segments written
+// by ANSencoder.  Decoding a symbol takes a table lookup in the model and
+// a multiplication, and requires no division.
+class ANSdecoder {
+public:
+  ANSdecoder(const void* buffer) : x(0), left(0), ptr(static_cast<const uchar*>(buffer)), begin(ptr) {}
+
+  // start decoding another stream from the given buffer (call init() next)
+  void open(const void* buffer)
+  {
+    x = 0;
+    begin = ptr = static_cast<const uchar*>(buffer);
+  }
+
+  // initialize decoding
+  void init() { left = 0; }
+
+  // decode a number s : 0 <= s < 2^n
+  template <typename UINT>
+  UINT decode(uint n);
+
+  // decode a symbol using probability model of concrete type R
+  template <class R>
+  uint decode(R* rm);
+
+  // number of bytes read
+  size_t bytes() const { return ptr - begin; }
+
+private:
+  uint decode_shift(uint n);
+  void start();
+  void normalize();
+
+  uint               x;     // coder state
+  uint               left;  // number of symbols left in segment
+  const uchar*       ptr;   // next byte to read
+  const uchar*       begin; // first byte of buffer
+};
+
+#include "ansdecoder.inl"
+
+#endif
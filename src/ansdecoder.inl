@@ -0,0 +1,56 @@
+template <typename UINT>
+inline UINT ANSdecoder::decode(uint n)
+{
+  UINT s = 0;
+  uint m = 0;
+  for (uint i = 1; i < (uint)sizeof(s) / 2; i++)
+    if (n > 16) {
+      s += UINT(decode_shift(16)) << m;
+      m += 16;
+      n -= 16;
+    }
+  return (UINT(decode_shift(n)) << m) + s;
+}
+
+// decode a symbol using probability modeling (see rcdecoder.inl)
+template <class R>
+inline uint ANSdecoder::decode(R* rm)
+{
+  if (!left)
+    start();
+  left--;
+  uint mask = (1u << rm->bits) - 1;
+  uint l = x & mask;
+  uint r;
+  uint s = rm->R::decode(l, r);
+  x = r * (x >> rm->bits) + (x & mask) - l;
+  normalize();
+  return s;
+}
+
+// decode a number s : 0 <= s < 2^n <= 2^16
+inline uint ANSdecoder::decode_shift(uint n)
+{
+  if (!left)
+    start();
+  left--;
+  uint s = x & ((1u << n) - 1);
+  x >>= n;
+  normalize();
+  return s;
+}
+
+// read state at start of segment
+inline void ANSdecoder::start()
+{
+  x = (uint)ptr[0] << 0 | (uint)ptr[1] << 8 | (uint)ptr[2] << 16 | (uint)ptr[3] << 24;
+  ptr += 4;
+  left = ANS_SEGMENT;
+}
+
+// renormalize state and input data
+inline void ANSdecoder::normalize()
+{
+  while (x < ANS_LOW)
+    x = (x << 8) | *ptr++;
+}
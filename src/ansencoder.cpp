@@ -0,0 +1,40 @@
+#include <cstddef>
+#include "ansencoder.h"
+
+// finalize encoder
+void ANSencoder::finish()
+{
+  flush();
+}
+
+// code recorded symbols in reverse order and emit them
+void ANSencoder::flush()
+{
+  if (symbol.empty())
+    return;
+
+  // each symbol produces at most two bytes; the state takes four
+  buffer.resize(2 * symbol.size() + 4);
+  uchar* end = &buffer[0] + buffer.size();
+  uchar* ptr = end;
+  uint x = ANS_LOW;
+  for (size_t i = symbol.size(); i--;) {
+    const Symbol& s = symbol[i];
+    // output bytes until state can absorb symbol without overflow
+    uint xmax = ((ANS_LOW >> s.bits) << 8) * s.f;
+    while (x >= xmax) {
+      *--ptr = (uchar)x;
+      x >>= 8;
+    }
+    x = ((x / s.f) << s.bits) + (x % s.f) + s.l;
+  }
+  // output final state, least significant byte first
+  ptr -= 4;
+  ptr[0] = (uchar)(x >> 0);
+  ptr[1] = (uchar)(x >> 8);
+  ptr[2] = (uchar)(x >> 16);
+  ptr[3] = (uchar)(x >> 24);
+
+  sink->putbytes(ptr, end - ptr);
+  symbol.clear();
+}
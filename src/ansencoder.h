@@ -0,0 +1,54 @@
+#ifndef ANS_ENCODER_H
+#define ANS_ENCODER_H
+
+#include <vector>
+#include "types.h"
+#include "rcmodel.h"
+#include "rcencoder.h"
+#include "anscodec.h"
+
+// Byte-wise range asymmetric numeral system (rANS) encoder.  rANS codes
+// symbols in reverse order, while adaptive models must be updated in
+// forward order.  Hence the encoder records the frequencies of a segment
+// of symbols and codes them in reverse once the segment is full.  Each
+// segment is emitted to a byte sink as the final coder state followed by
+// the renormalization bytes in the order the decoder consumes them.
+class ANSencoder {
+public:
+  ANSencoder(RCencoder* sink) : sink(sink) { symbol.reserve(ANS_SEGMENT); }
+
+  // discard any recorded symbols for encoding another stream
+  void reset() { symbol.clear(); }
+
+  // finish encoding
+  void finish();
+
+  // encode a number s : 0 <= s < 2^n
+  template <typename UINT>
+  void encode(UINT s, uint n);
+
+  // encode a symbol s using probability model of concrete type R
+  template <class R>
+  void encode(uint s, R* rm);
+
+private:
+  // symbol with frequency f and cumulative frequency l out of 2^bits
+  struct Symbol {
+    Symbol(uint l, uint f, uint bits) : l(l), f(f), bits(bits) {}
+    uint l;
+    uint f;
+    uint bits;
+  };
+
+  void encode_shift(uint s, uint n);
+  void push(uint l, uint f, uint bits);
+  void flush();
+
+  RCencoder*          sink;   // destination of coded segments
+  std::vector<Symbol> symbol; // symbols of current segment
+  std::vector<uchar>  buffer; // coded segment, filled back to front
+};
+
+#include "ansencoder.inl"
+
+#endif
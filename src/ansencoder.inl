@@ -0,0 +1,37 @@
+// The static for loop below enables unrolling of the otherwise data
+// dependent loop for basic integer types (see rcencoder.inl).
+
+template <typename UINT>
+inline void ANSencoder::encode(UINT s, uint n)
+{
+  for (uint i = 1; i < (uint)sizeof(s) / 2; i++)
+    if (n > 16) {
+      encode_shift(s & 0xffff, 16);
+      s >>= 16;
+      n -= 16;
+    }
+  encode_shift(static_cast<uint>(s), n);
+}
+
+// encode a symbol s using probability modeling (see rcencoder.inl)
+template <class R>
+inline void ANSencoder::encode(uint s, R* rm)
+{
+  uint l, r;
+  rm->R::encode(s, l, r);
+  push(l, r, rm->bits);
+}
+
+// encode a number s : 0 <= s < 2^n <= 2^16
+inline void ANSencoder::encode_shift(uint s, uint n)
+{
+  push(s, 1, n);
+}
+
+// record symbol and code segment once full
+inline void ANSencoder::push(uint l, uint f, uint bits)
+{
+  symbol.push_back(Symbol(l, f, bits));
+  if (symbol.size() == ANS_SEGMENT)
+    flush();
+}
@@ -0,0 +1,70 @@
+#ifndef FPZIP_BATCH_H
+#define FPZIP_BATCH_H
+
+#include <climits>
+#include <cstddef>
+#include <vector>
+#include "fpzip.h"
+#include "types.h"
+
+// minimum number of samples per batch segment (except the last)
+#define FPZ_BATCH_SAMPLES 0x10000
+
+// meta data of an array in a batch
+struct BatchItem {
+  BatchItem() : type(FPZIP_TYPE_FLOAT), prec(0), nx(0), ny(0), nz(0), nf(0) {}
+  BatchItem(const FPZ* fpz) : type(fpz->type), prec(fpz->prec), nx(fpz->nx), ny(fpz->ny), nz(fpz->nz), nf(fpz->nf) {}
+
+  // number of samples in array
+  uint64 samples() const { return (uint64)nx * ny * nz * nf; }
+
+  // number of bytes in array
+  size_t bytes() const { return nx * ny * nz * nf * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double)); }
+
+  // number of bits of precision
+  int bits() const { return prec ? prec : (int)(CHAR_BIT * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double))); }
+
+  bool operator==(const BatchItem& b) const
+  {
+    return type == b.type && prec == b.prec && nx == b.nx && ny == b.ny && nz == b.nz && nf == b.nf;
+  }
+
+  int type;              // type of array
+  int prec;              // number of bits of precision (zero = full)
+  size_t nx, ny, nz, nf; // array dimensions
+};
+
+// Partition of a batch into segments of consecutive items that share an
+// entropy coder and probability models.  A segment is closed once it holds
+// at least FPZ_BATCH_SAMPLES samples, which depends only on the meta data
+// of the items and hence is reproduced by the decoder.
+class Batching {
+public:
+  Batching(const std::vector<BatchItem>& item) : start(1, 0)
+  {
+    uint64 samples = 0;
+    for (uint i = 0; i < item.size(); i++) {
+      samples += item[i].samples();
+      if (samples >= FPZ_BATCH_SAMPLES || i + 1 == item.size()) {
+        start.push_back(i + 1);
+        samples = 0;
+      }
+    }
+    if (item.empty())
+      start.clear();
+  }
+
+  // number of segments
+  uint count() const { return start.empty() ? 0 : (uint)start.size() - 1; }
+
+  // first item of segment s
+  uint first(uint s) const { return start[s]; }
+
+  // one past last item of segment s
+  uint last(uint s) const { return start[s + 1]; }
+
+private:
+  std::vector<uint> start; // first item of each segment and one past last item
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FPZIP_CHUNK_H
+#define FPZIP_CHUNK_H
+
+#include <cstddef>
+#include "fpzip.h"
+#include "types.h"
+
+// partition of nf fields of nx * ny * nz samples into chunks of at most
+// cx * cy * cz samples, ordered by field, then z, y, and x
+class Chunking {
+public:
+  Chunking(const FPZ* fpz) :
+    nx(fpz->nx), ny(fpz->ny), nz(fpz->nz), nf(fpz->nf),
+    cx(extent(fpz->cx, nx)), cy(extent(fpz->cy, ny)), cz(extent(fpz->cz, nz)),
+    mx((nx + cx - 1) / cx), my((ny + cy - 1) / cy), mz((nz + cz - 1) / cz)
+  {}
+
+  // is the stream partitioned into chunks?
+  static bool enabled(const FPZ* fpz) { return fpz->cx > 0 || fpz->cy > 0 || fpz->cz > 0; }
+
+  // total number of chunks
+  size_t count() const { return field_count() * nf; }
+
+  // number of chunks per field
+  size_t field_count() const { return mx * my * mz; }
+
+  // offset into 4D array and dimensions of chunk i
+  size_t chunk(size_t i, size_t& sx, size_t& sy, size_t& sz) const
+  {
+    size_t x, y, z, f;
+    origin(i, x, y, z, f);
+    sx = cx < nx - x ? cx : nx - x;
+    sy = cy < ny - y ? cy : ny - y;
+    sz = cz < nz - z ? cz : nz - z;
+    return x + nx * (y + ny * (z + nz * f));
+  }
+
+  // first sample (x, y, z) and field f of chunk i
+  void origin(size_t i, size_t& x, size_t& y, size_t& z, size_t& f) const
+  {
+    x = i % mx; i /= mx;
+    y = i % my; i /= my;
+    z = i % mz; i /= mz;
+    f = i;
+    x *= cx;
+    y *= cy;
+    z *= cz;
+  }
+
+  const size_t nx, ny, nz, nf; // array dimensions
+  const size_t cx, cy, cz;     // chunk dimensions
+  const size_t mx, my, mz;     // number of chunks per field along x, y, z
+
+private:
+  // chunk extent c (zero = n) clamped to [1, n]
+  static size_t extent(int c, size_t n) { return 0 < c && (size_t)c < n ? (size_t)c : n ? n : 1; }
+};
+
+#endif
@@ -24,7 +24,31 @@ struct PCmap<T, width, T> {
 };
 #endif
 
-#define FPZ_MAJ_VERSION 0x0110
+#define FPZ_MAJ_VERSION 0x0110 // format of unchunked streams with default options
+#define FPZ_EXT_VERSION 0x0111 // format with extended header listing its options
+#define FPZ_MAX_LANES   0xff   // maximum number of range coder lanes
 #define FPZ_MIN_VERSION FPZIP_FP
 
+// Options of extended headers.  The header stores a 16-bit word of flags
+// for the options that are present; options not flagged take their default
+// values.  A flagged option is followed by its value, if any, in the order
+// of the flags below.  Readers reject streams with flags they do not know.
+#define FPZ_OPT_BATCH     0x0001u // batch of arrays rather than single array
+#define FPZ_OPT_WIDE      0x0002u // 64-bit array dimensions
+#define FPZ_OPT_CHUNKED   0x0004u // chunk dimensions (3 x 32 bits)
+#define FPZ_OPT_LANES     0x0008u // number of lanes (8 bits)
+#define FPZ_OPT_CODER     0x0010u // entropy coder (8 bits)
+#define FPZ_OPT_MODEL     0x0020u // probability model (8 bits)
+#define FPZ_OPT_BYPASS    0x0040u // raw bit bypass
+#define FPZ_OPT_PREDICTOR 0x0080u // predictor (8 bits)
+#define FPZ_OPT_KNOWN     0x00ffu // all options known to this version
+#define FPZ_OPT_UNKNOWN   0x10000u // reported by reader for unknown options
+
+// predictors selected per row by adaptive prediction
+#define FPZ_PRED_LORENZO 0 // 3D Lorenzo
+#define FPZ_PRED_PLANE   1 // 2D Lorenzo within current plane
+#define FPZ_PRED_PREV    2 // previous sample in row
+#define FPZ_PRED_LINEAR  3 // linear extrapolation of two previous samples
+#define FPZ_PRED_BITS    2 // number of bits coded per row
+
 #endif
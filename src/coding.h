@@ -0,0 +1,41 @@
+#ifndef FPZIP_CODING_H
+#define FPZIP_CODING_H
+
+#include "fpzip.h"
+#include "types.h"
+
+// prediction and entropy coding options of a stream
+class Coding {
+public:
+  Coding(const FPZ* fpz) :
+    lanes(fpz->lanes > 1 ? fpz->lanes : 1), coder(fpz->coder), model(fpz->model), bypass(fpz->bypass != 0),
+    adaptive(fpz->predictor == FPZIP_PREDICTOR_ADAPTIVE)
+  {}
+
+  // are the lanes of a 3D array coded separately and preceded by a table
+  // of their sizes rather than embedded in the range coded stream?
+  bool separate() const { return lanes > 1 || coder != FPZIP_CODER_RANGE || bypass; }
+
+  // number of separately coded streams: the lanes followed by their raw bits
+  uint streams() const { return bypass ? 2 * lanes : lanes; }
+
+  // are probability models semi-static?
+  bool fixed() const { return model == FPZIP_MODEL_STATIC; }
+
+  // are probability models selected by context?
+  bool contextual() const { return model == FPZIP_MODEL_CONTEXT; }
+
+  // do two streams use the same options?
+  bool operator==(const Coding& c) const
+  {
+    return lanes == c.lanes && coder == c.coder && model == c.model && bypass == c.bypass && adaptive == c.adaptive;
+  }
+
+  const uint lanes; // number of lanes
+  const uint coder; // entropy coder
+  const uint model; // probability model
+  const bool bypass; // are low bits of residuals stored uncoded?
+  const bool adaptive; // is the predictor selected per row?
+};
+
+#endif
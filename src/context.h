@@ -0,0 +1,72 @@
+#ifndef FPZIP_CONTEXT_H
+#define FPZIP_CONTEXT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "types.h"
+
+// Selects one of several probability models for the residual of each
+// sample from the activity of its left, below, and behind neighbors,
+// whose residuals have already been coded.  Activity is the magnitude of
+// a residual symbol relative to perfect prediction, or its bit length for
+// small alphabets.  Samples are visited in raster order a row at a time.
+class Context {
+public:
+  Context(uint symbols, bool wide, size_t nx, size_t ny) :
+    mx(nx + 1), ny(ny), y(ny - 1), row(0), activity(symbols), a(mx * (ny + 1), 0)
+  {
+    uint bias = (symbols - 1) / 2;
+    for (uint s = 0; s < symbols; s++) {
+      uint e = s > bias ? s - bias : bias - s;
+      uint k = 0;
+      if (!wide)
+        while (e >> k)
+          k++;
+      activity[s] = (uchar)(wide ? e : k);
+    }
+    // quantize weighted sum of neighbor activities uniformly
+    uint n = 4 * activity[0] + 1;
+    bucket.resize(n);
+    for (uint i = 0; i < n; i++)
+      bucket[i] = (uchar)(i * count / n);
+  }
+
+  // start over with no samples coded
+  void reset()
+  {
+    y = ny - 1;
+    row = 0;
+    std::fill(a.begin(), a.end(), 0);
+  }
+
+  // advance to next row
+  void advance()
+  {
+    y = (y + 1 == ny ? 0 : y + 1);
+    row = &a[mx * (y + 1) + 1];
+  }
+
+  // context of sample x in current row
+  uint operator()(size_t x) const
+  {
+    const uchar* p = row + x;
+    return bucket[2 * p[-1] + p[-(ptrdiff_t)mx] + p[0]];
+  }
+
+  // record symbol s coded for sample x in current row
+  void update(size_t x, uint s) { row[x] = activity[s]; }
+
+  static const uint count = 32; // number of contexts
+
+private:
+  const size_t       mx;       // padded row size
+  const size_t       ny;       // number of rows per plane
+  size_t             y;        // index of current row
+  uchar*             row;      // activities of current row
+  std::vector<uchar> activity; // activity of each symbol
+  std::vector<uchar> bucket;   // context of each sum of activities
+  std::vector<uchar> a;        // activities of current and previous plane
+};
+
+#endif
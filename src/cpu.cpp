@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <cstring>
+#include "cpu.h"
+
+// detect instruction set extensions supported by processor
+static uint
+detect()
+{
+  uint level = FPZIP_CPU_BASELINE;
+#if FPZIP_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2")) {
+    level = FPZIP_CPU_SSE42;
+    if (__builtin_cpu_supports("avx2")) {
+      level = FPZIP_CPU_AVX2;
+      if (__builtin_cpu_supports("avx512f") &&
+          __builtin_cpu_supports("avx512vl") &&
+          __builtin_cpu_supports("avx512bw") &&
+          __builtin_cpu_supports("avx512dq"))
+        level = FPZIP_CPU_AVX512;
+    }
+  }
+#endif
+  // allow selecting a less capable extension, e.g., for testing
+  static const char* const name[] = { "baseline", "sse4.2", "avx2", "avx512" };
+  const char* env = getenv("FPZIP_CPU");
+  if (env)
+    for (uint i = 0; i < level; i++)
+      if (!strcmp(env, name[i]))
+        level = i;
+  return level;
+}
+
+static const uint level = detect();
+
+uint
+fpzip_cpu()
+{
+  return level;
+}
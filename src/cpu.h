@@ -0,0 +1,25 @@
+#ifndef FPZIP_CPU_H
+#define FPZIP_CPU_H
+
+#include "types.h"
+
+// instruction set extensions that kernels are compiled for, in order of
+// increasing capability
+#define FPZIP_CPU_BASELINE 0 // instructions enabled at build time
+#define FPZIP_CPU_SSE42    1 // SSE4.2
+#define FPZIP_CPU_AVX2     2 // AVX2
+#define FPZIP_CPU_AVX512   3 // AVX-512 F, VL, BW, and DQ
+
+// Run-time dispatch requires the GCC/Clang target attribute and processor
+// detection builtins, which are available on x86-64 only.  Elsewhere, all
+// kernels are compiled for the baseline instruction set.
+#if defined FPZIP_WITH_DISPATCH && defined __GNUC__ && defined __x86_64__
+  #define FPZIP_DISPATCH 1
+  #define FPZIP_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// most capable extension supported by the processor, as detected once at
+// startup and optionally lowered via the FPZIP_CPU environment variable
+uint fpzip_cpu();
+
+#endif
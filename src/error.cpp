@@ -1,6 +1,21 @@
 #include "fpzip.h"
 
-fpzipError fpzip_errno;
+// error code of each thread
+#if __cplusplus >= 201103L
+  #define thread_local_ thread_local
+#elif defined(_MSC_VER)
+  #define thread_local_ __declspec(thread)
+#else
+  #define thread_local_ __thread
+#endif
+
+static thread_local_ fpzipError error = fpzipSuccess;
+
+fpzipError*
+fpzip_errno_location()
+{
+  return &error;
+}
 
 const char* const fpzip_errstr[] = {
   "success",
@@ -11,4 +26,5 @@ const char* const fpzip_errstr[] = {
   "precision not supported",
   "memory buffer overflow",
   "internal error",
+  "invalid argument",
 };
@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <cstdlib>
+#include "filemap.h"
+#if FPZIP_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileMap::FileMap(const char* path) : begin(0), bytes(0), mapped(false), ok(false)
+{
+#if FPZIP_MMAP
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (!fstat(fd, &st) && S_ISREG(st.st_mode)) {
+    bytes = (size_t)st.st_size;
+    if (!bytes)
+      ok = true;
+    else {
+      void* p = mmap(0, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        // data is decoded front to back; start reading it ahead right away
+        madvise(p, bytes, MADV_SEQUENTIAL);
+        madvise(p, bytes, MADV_WILLNEED);
+        begin = static_cast<uchar*>(p);
+        mapped = true;
+        ok = true;
+      }
+    }
+  }
+  close(fd);
+  if (ok)
+    return;
+  bytes = 0;
+#endif
+  ok = read(path);
+}
+
+FileMap::~FileMap()
+{
+#if FPZIP_MMAP
+  if (mapped) {
+    munmap(begin, bytes);
+    return;
+  }
+#endif
+  free(begin);
+}
+
+// read whole file into memory
+bool
+FileMap::read(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return false;
+  size_t capacity = 0;
+  for (;;) {
+    if (bytes == capacity) {
+      size_t c = 2 * capacity + 0x10000;
+      uchar* p = static_cast<uchar*>(realloc(begin, c));
+      if (!p)
+        break;
+      begin = p;
+      capacity = c;
+    }
+    size_t n = fread(begin + bytes, 1, capacity - bytes, file);
+    if (!n)
+      break;
+    bytes += n;
+  }
+  bool success = !ferror(file) && feof(file);
+  fclose(file);
+  return success;
+}
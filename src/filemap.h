@@ -0,0 +1,41 @@
+#ifndef FPZIP_FILEMAP_H
+#define FPZIP_FILEMAP_H
+
+#include <cstddef>
+#include "types.h"
+
+// Memory mapping of files requires POSIX mmap.  Elsewhere, and for files
+// that cannot be mapped, such as pipes, the file is read into memory.
+#if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+  #define FPZIP_MMAP 1
+#endif
+
+// read-only view of the contents of a file
+class FileMap {
+public:
+  // map file at given path into memory; check valid() for success
+  FileMap(const char* path);
+  ~FileMap();
+
+  // was the file opened and mapped or read?
+  bool valid() const { return ok; }
+
+  // file contents
+  const uchar* data() const { return begin; }
+
+  // file size in bytes
+  size_t size() const { return bytes; }
+
+private:
+  FileMap(const FileMap&);
+  FileMap& operator=(const FileMap&);
+
+  bool read(const char* path);
+
+  uchar* begin;  // first byte of file contents
+  size_t bytes;  // number of bytes in file
+  bool   mapped; // are contents mapped rather than allocated?
+  bool   ok;     // was file opened successfully?
+};
+
+#endif
@@ -1,17 +1,21 @@
 #ifndef FRONT_H
 #define FRONT_H
 
+#include <cstddef>
 #include "types.h"
 
 // front of encoded but not finalized samples
 template <typename T>
 class Front {
 public:
-  Front(uint nx, uint ny, T zero = 0)
+  Front(size_t nx, size_t ny, T zero = 0)
     : zero(zero), dx(1), dy(nx + 1), dz(dy * (ny + 1)), m(mask(dx + dy + dz)),
       i(0), a(new T[m + 1]) {}
   ~Front() { delete[] a; }
 
+  // start over with an empty front
+  void reset() { i = 0; }
+
   // fetch neighbor relative to current sample
   const T& operator()(uint x, uint y, uint z) const
   {
@@ -19,7 +23,7 @@ public:
   }
 
   // add n copies of sample f to front
-  void push(T f, uint n = 1)
+  void push(T f, size_t n = 1)
   {
     do
       a[i++ & m] = f;
@@ -33,16 +37,16 @@ public:
   }
 
 private:
-  const T    zero; // default value
-  const uint dx;   // front index x offset
-  const uint dy;   // front index y offset
-  const uint dz;   // front index z offset
-  const uint m;    // index mask
-  uint       i;    // modular index of current sample
-  T*const    a;    // circular array of samples
+  const T      zero; // default value
+  const size_t dx;   // front index x offset
+  const size_t dy;   // front index y offset
+  const size_t dz;   // front index z offset
+  const size_t m;    // index mask
+  size_t       i;    // modular index of current sample
+  T*const      a;    // circular array of samples
 
   // return m = 2^k - 1 >= n - 1
-  uint mask(uint n) const
+  size_t mask(size_t n) const
   {
     for (n--; n & (n + 1); n |= n + 1);
     return n;
@@ -4,6 +4,9 @@ uint bsr(U x)
   uint k;
 #if __i386__ && USEASM
   __asm__("bsr %1, %0" : "=r"(k) : "r"(x));
+#elif defined __GNUC__
+  // count leading zeros using a single instruction where available
+  k = sizeof(U) <= sizeof(uint) ? 31 - __builtin_clz((uint)x) : 63 - __builtin_clzll((uint64)x);
 #else
   k = 0;
   do k++; while (x >>= 1);
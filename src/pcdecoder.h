@@ -7,15 +7,30 @@
 #include "rcdecoder.h"
 #include "rcmodel.h"
 
-template <typename T, class M = PCmap<T>, bool wide = (M::bits > PC_BIT_MAX)>
+template <typename T, class M = PCmap<T>, class D = RCdecoder, bool wide = (M::bits > PC_BIT_MAX)>
 class PCdecoder {
 public:
-  PCdecoder(RCdecoder* rd, RCmodel*const* rm);
+  PCdecoder(D* rd, RCmodel*const* rm);
   ~PCdecoder();
 
-  // decode a value with prediction and optional context
+  // residual of a value with respect to its prediction
+  struct Residual;
+
+  // decode a value with prediction and optional context using probability
+  // models of concrete type R
+  template <class R>
   T decode(T pred, uint context = 0);
 
+  // decode a residual to be combined with a prediction by reconstruct()
+  template <class R>
+  Residual decode_residual(uint context = 0);
+
+  // reconstruct a value from its prediction and residual
+  static T reconstruct(T pred, const Residual& d);
+
+  // symbol coded for a residual
+  static uint symbol(const Residual& d);
+
   // number of symbols (needed by probability modeler)
   static const uint symbols;
 };
@@ -1,67 +1,117 @@
 // specialization for small alphabets -----------------------------------------
 
-template <typename T, class M>
-class PCdecoder<T, M, false> {
+template <typename T, class M, class D>
+class PCdecoder<T, M, D, false> {
 public:
-  PCdecoder(RCdecoder* rd, RCmodel*const* rm) : rd(rd), rm(rm) {}
+  PCdecoder(D* rd, RCmodel*const* rm) : rd(rd), rm(rm) {}
   ~PCdecoder() {}
+  typedef uint Residual; // symbol for r - p
+  template <class R>
   T decode(T pred, uint context = 0);
+  template <class R>
+  Residual decode_residual(uint context = 0);
+  static T reconstruct(T pred, Residual d);
+  static uint symbol(Residual d) { return d; }
   static const uint symbols = 2 * (1 << M::bits) - 1;
 private:
   static const uint bias = (1 << M::bits) - 1;
-  M                 map;            // maps T to some unsigned integer type
-  RCdecoder*const   rd;             // entropy decoder
+  D*const           rd;             // entropy decoder
   RCmodel*const*    rm;             // probability modeler(s)
 };
 
 // decode narrow range type
-template <typename T, class M>
-T PCdecoder<T, M, false>::decode(T pred, uint context)
+template <typename T, class M, class D>
+template <class R>
+T PCdecoder<T, M, D, false>::decode(T pred, uint context)
+{
+  return reconstruct(pred, decode_residual<R>(context));
+}
+
+// entropy decode symbol for d = r - p
+template <typename T, class M, class D>
+template <class R>
+typename PCdecoder<T, M, D, false>::Residual PCdecoder<T, M, D, false>::decode_residual(uint context)
+{
+  return rd->decode(static_cast<R*>(rm[context]));
+}
+
+// reconstruct narrow range type
+template <typename T, class M, class D>
+T PCdecoder<T, M, D, false>::reconstruct(T pred, Residual d)
 {
   // map type T to unsigned integer type
   typedef typename M::Range U;
+  M map;
   U p = map.forward(pred);
-  // entropy decode d = r - p
-  U r = p + rd->decode(rm[context]) - bias;
+  U r = p + d - bias;
   return map.inverse(r);
 }
 
 // specialization for large alphabets -----------------------------------------
 
-template <typename T, class M>
-class PCdecoder<T, M, true> {
+template <typename T, class M, class D>
+class PCdecoder<T, M, D, true> {
 public:
-  PCdecoder(RCdecoder* rd, RCmodel*const* rm) : rd(rd), rm(rm) {}
+  PCdecoder(D* rd, RCmodel*const* rm) : rd(rd), rm(rm) {}
   ~PCdecoder() {}
+  struct Residual {
+    uint              s; // symbol for sign and bit length k of r - p
+    typename M::Range d; // |r - p|
+  };
+  template <class R>
   T decode(T pred, uint context = 0);
+  template <class R>
+  Residual decode_residual(uint context = 0);
+  static T reconstruct(T pred, const Residual& d);
+  static uint symbol(const Residual& d) { return d.s; }
   static const uint symbols = 2 * M::bits + 1;
 private:
   static const uint bias = M::bits;
-  M                 map;            // maps T to some unsigned integer type
-  RCdecoder*const   rd;             // entropy decoder
+  D*const           rd;             // entropy decoder
   RCmodel*const*    rm;             // probability modeler(s)
 };
 
 // decode wide range type
-template <typename T, class M>
-T PCdecoder<T, M, true>::decode(T pred, uint context)
+template <typename T, class M, class D>
+template <class R>
+T PCdecoder<T, M, D, true>::decode(T pred, uint context)
+{
+  return reconstruct(pred, decode_residual<R>(context));
+}
+
+// entropy decode (s, k) and decode the k-bit number m verbatim
+template <typename T, class M, class D>
+template <class R>
+typename PCdecoder<T, M, D, true>::Residual PCdecoder<T, M, D, true>::decode_residual(uint context)
+{
+  typedef typename M::Range U;
+  Residual d;
+  d.s = rd->decode(static_cast<R*>(rm[context]));
+  if (d.s != bias) {
+    uint k = d.s > bias ? d.s - bias - 1 : bias - 1 - d.s;
+    d.d = (U(1) << k) + rd->template decode<U>(k);
+  }
+  else
+    d.d = 0;
+  return d;
+}
+
+// reconstruct wide range type from (-1)^s (2^k + m) = r - p
+template <typename T, class M, class D>
+T PCdecoder<T, M, D, true>::reconstruct(T pred, const Residual& d)
 {
   typedef typename M::Range U;
-  uint s = rd->decode(rm[context]);
-  if (s > bias) {      // underprediction
-    uint k = s - bias - 1;
-    U d = (U(1) << k) + rd->template decode<U>(k);
+  M map;
+  if (d.s > bias) {      // underprediction
     U p = map.forward(pred);
-    U r = p + d;
+    U r = p + d.d;
     return map.inverse(r);
   }
-  else if (s < bias) { // overprediction
-    uint k = bias - 1 - s;
-    U d = (U(1) << k) + rd->template decode<U>(k);
+  else if (d.s < bias) { // overprediction
     U p = map.forward(pred);
-    U r = p - d;
+    U r = p - d.d;
     return map.inverse(r);
   }
-  else                 // perfect prediction
+  else                   // perfect prediction
     return map.identity(pred);
 }
@@ -7,14 +7,33 @@
 #include "rcencoder.h"
 #include "rcmodel.h"
 
-template <typename T, class M = PCmap<T>, bool wide = (M::bits > PC_BIT_MAX)>
+template <typename T, class M = PCmap<T>, class E = RCencoder, bool wide = (M::bits > PC_BIT_MAX)>
 class PCencoder {
 public:
-  PCencoder(RCencoder* re, RCmodel*const* rm);
+  PCencoder(E* re, RCmodel*const* rm);
 
-  // encode a value with prediction and optional context
+  // residual of a value with respect to its prediction
+  struct Residual;
+
+  // encode a value with prediction and optional context using probability
+  // models of concrete type R
+  template <class R>
   T encode(T real, T pred, uint context = 0);
 
+  // encode a value and its prediction already mapped to integers
+  template <class R>
+  void encode_mapped(typename M::Range r, typename M::Range p, uint context = 0);
+
+  // compute residual of value and prediction already mapped to integers
+  static Residual residual(typename M::Range r, typename M::Range p);
+
+  // encode a residual
+  template <class R>
+  void encode_residual(const Residual& d, uint context = 0);
+
+  // symbol coded for a residual
+  static uint symbol(const Residual& d);
+
   // number of symbols (needed by probability modeler)
   static const uint symbols;
 };
@@ -1,71 +1,145 @@
 // specialization for small alphabets -----------------------------------------
 
-template <typename T, class M>
-class PCencoder<T, M, false> {
+template <typename T, class M, class E>
+class PCencoder<T, M, E, false> {
 public:
-  PCencoder(RCencoder* re, RCmodel*const* rm) : re(re), rm(rm) {}
+  PCencoder(E* re, RCmodel*const* rm) : re(re), rm(rm) {}
+  typedef uint Residual; // symbol for r - p
+  template <class R>
   T encode(T real, T pred, uint context = 0);
+  template <class R>
+  void encode_mapped(typename M::Range r, typename M::Range p, uint context = 0);
+  static Residual residual(typename M::Range r, typename M::Range p);
+  template <class R>
+  void encode_residual(Residual d, uint context = 0);
+  static uint symbol(Residual d) { return d; }
   static const uint symbols = 2 * (1 << M::bits) - 1;
 private:
   static const uint bias = (1 << M::bits) - 1; // perfect prediction symbol
   M                 map;                       // maps T to integer type
-  RCencoder*const   re;                        // entropy encoder
+  E*const           re;                        // entropy encoder
   RCmodel*const*    rm;                        // probability modeler(s)
 };
 
 // encode narrow range type
-template <typename T, class M>
-T PCencoder<T, M, false>::encode(T real, T pred, uint context)
+template <typename T, class M, class E>
+template <class R>
+T PCencoder<T, M, E, false>::encode(T real, T pred, uint context)
 {
   // map type T to unsigned integer type
   typedef typename M::Range U;
   U r = map.forward(real);
   U p = map.forward(pred);
-  // entropy encode d = r - p
-  re->encode(static_cast<uint>(bias + r - p), rm[context]);
+  encode_mapped<R>(r, p, context);
   // return decoded value
   return map.inverse(r);
 }
 
+// encode mapped narrow range type
+template <typename T, class M, class E>
+template <class R>
+void PCencoder<T, M, E, false>::encode_mapped(typename M::Range r, typename M::Range p, uint context)
+{
+  // entropy encode d = r - p
+  encode_residual<R>(residual(r, p), context);
+}
+
+// map r - p to symbol
+template <typename T, class M, class E>
+typename PCencoder<T, M, E, false>::Residual PCencoder<T, M, E, false>::residual(typename M::Range r, typename M::Range p)
+{
+  return static_cast<uint>(bias + r - p);
+}
+
+// entropy encode symbol
+template <typename T, class M, class E>
+template <class R>
+void PCencoder<T, M, E, false>::encode_residual(Residual d, uint context)
+{
+  re->encode(d, static_cast<R*>(rm[context]));
+}
+
 // specialization for large alphabets -----------------------------------------
 
-template <typename T, class M>
-class PCencoder<T, M, true> {
+template <typename T, class M, class E>
+class PCencoder<T, M, E, true> {
 public:
-  PCencoder(RCencoder* re, RCmodel*const* rm) : re(re), rm(rm) {}
+  PCencoder(E* re, RCmodel*const* rm) : re(re), rm(rm) {}
+  struct Residual {
+    uint              s; // symbol for sign and bit length k of r - p
+    uint              k; // number of verbatim bits
+    typename M::Range m; // k-bit remainder of |r - p|
+  };
+  template <class R>
   T encode(T real, T pred, uint context = 0);
+  template <class R>
+  void encode_mapped(typename M::Range r, typename M::Range p, uint context = 0);
+  static Residual residual(typename M::Range r, typename M::Range p);
+  template <class R>
+  void encode_residual(const Residual& d, uint context = 0);
+  static uint symbol(const Residual& d) { return d.s; }
   static const uint symbols = 2 * M::bits + 1;
 private:
   static const uint bias = M::bits; // perfect prediction symbol
   M                 map;            // maps T to integer type
-  RCencoder*const   re;             // entropy encoder
+  E*const           re;             // entropy encoder
   RCmodel*const*    rm;             // probability modeler(s)
 };
 
 // encode wide range type
-template <typename T, class M>
-T PCencoder<T, M, true>::encode(T real, T pred, uint context)
+template <typename T, class M, class E>
+template <class R>
+T PCencoder<T, M, E, true>::encode(T real, T pred, uint context)
 {
   // map type T to unsigned integer type
   typedef typename M::Range U;
   U r = map.forward(real);
   U p = map.forward(pred);
-  // compute (-1)^s (2^k + m) = r - p, entropy code (s, k),
-  // and encode the k-bit number m verbatim
+  encode_mapped<R>(r, p, context);
+  // return decoded value
+  return map.inverse(r);
+}
+
+// encode mapped wide range type
+template <typename T, class M, class E>
+template <class R>
+void PCencoder<T, M, E, true>::encode_mapped(typename M::Range r, typename M::Range p, uint context)
+{
+  encode_residual<R>(residual(r, p), context);
+}
+
+// compute (-1)^s (2^k + m) = r - p
+template <typename T, class M, class E>
+typename PCencoder<T, M, E, true>::Residual PCencoder<T, M, E, true>::residual(typename M::Range r, typename M::Range p)
+{
+  typedef typename M::Range U;
+  Residual d;
   if (p < r) {      // underprediction
-    U d = r - p;
-    uint k = PC::bsr(d);
-    re->encode(bias + 1 + k, rm[context]);
-    re->encode(d - (U(1) << k), k);
+    U e = r - p;
+    d.k = PC::bsr(e);
+    d.s = bias + 1 + d.k;
+    d.m = e - (U(1) << d.k);
   }
   else if (p > r) { // overprediction
-    U d = p - r;
-    uint k = PC::bsr(d);
-    re->encode(bias - 1 - k, rm[context]);
-    re->encode(d - (U(1) << k), k);
+    U e = p - r;
+    d.k = PC::bsr(e);
+    d.s = bias - 1 - d.k;
+    d.m = e - (U(1) << d.k);
   }
-  else              // perfect prediction
-    re->encode(bias, rm[context]);
-  // return decoded value
-  return map.inverse(r);
+  else {            // perfect prediction
+    d.s = bias;
+    d.k = 0;
+    d.m = 0;
+  }
+  return d;
+}
+
+// entropy code (s, k) and encode the k-bit number m verbatim
+template <typename T, class M, class E>
+template <class R>
+void PCencoder<T, M, E, true>::encode_residual(const Residual& d, uint context)
+{
+  re->encode(d.s, static_cast<R*>(rm[context]));
+  if (d.s != bias)
+    re->encode(d.m, d.k);
 }
@@ -0,0 +1,52 @@
+#ifndef RAW_DECODER_H
+#define RAW_DECODER_H
+
+#include <cstddef>
+#include "types.h"
+#include "rcmodel.h"
+
+// Decoder for the symbols and raw bits written by RAWencoder.  Raw bits are
+// read from a memory buffer with shifts and masks; reads past the end of
+// the buffer yield zero bits.
+template <class D>
+class RAWdecoder {
+public:
+  RAWdecoder(D* coder, const void* data, size_t size) : coder(coder), ptr(static_cast<const uchar*>(data)), end(ptr + size), begin(ptr), excess(0), buffer(0), count(0) {}
+
+  // start reading raw bits of another stream from the given buffer
+  void open(const void* data, size_t size)
+  {
+    begin = ptr = static_cast<const uchar*>(data);
+    end = ptr + size;
+    excess = 0;
+    buffer = 0;
+    count = 0;
+  }
+
+  // read a number s : 0 <= s < 2^n
+  template <typename UINT>
+  UINT decode(uint n);
+
+  // decode a symbol using probability model of concrete type R
+  template <class R>
+  uint decode(R* rm) { return coder->decode(rm); }
+
+  // number of raw bytes read
+  size_t bytes() const { return (ptr - begin) + excess - count / 8; }
+
+private:
+  uint get(uint n);
+  void fill();
+
+  D*const            coder;  // entropy decoder for symbols
+  const uchar*       ptr;    // next byte to read
+  const uchar*       end;    // end of buffer
+  const uchar*       begin;  // first byte of buffer
+  size_t             excess; // number of bytes read past end of buffer
+  uint64             buffer; // pending bits
+  uint               count;  // number of pending bits
+};
+
+#include "rawdecoder.inl"
+
+#endif
@@ -0,0 +1,48 @@
+template <class D>
+template <typename UINT>
+inline UINT RAWdecoder<D>::decode(uint n)
+{
+  uint64 v = 0;
+  uint m = 0;
+  if (sizeof(UINT) > 4 && n > 32) {
+    v = get(32);
+    m = 32;
+    n -= 32;
+  }
+  return UINT(v + ((uint64)get(n) << m));
+}
+
+// extract a number s : 0 <= s < 2^n <= 2^32
+template <class D>
+inline uint RAWdecoder<D>::get(uint n)
+{
+  if (count < n)
+    fill();
+  uint s = (uint)(buffer & ((uint64(1) << n) - 1));
+  buffer >>= n;
+  count -= n;
+  return s;
+}
+
+// read whole bytes until at least 57 bits are pending
+template <class D>
+inline void RAWdecoder<D>::fill()
+{
+  if (end - ptr >= 8) {
+    // load eight bytes at once and keep those that fit; any partial byte
+    // is loaded again, in the same position, by the next call
+    uint64 word = 0;
+    for (uint i = 0; i < 8; i++)
+      word += (uint64)ptr[i] << (8 * i);
+    buffer |= word << count;
+    uint n = (63 - count) / 8;
+    ptr += n;
+    count += 8 * n;
+  }
+  else
+    for (; count <= 56; count += 8)
+      if (ptr < end)
+        buffer |= (uint64)*ptr++ << count;
+      else
+        excess++;
+}
@@ -0,0 +1,46 @@
+#ifndef RAW_ENCODER_H
+#define RAW_ENCODER_H
+
+#include "types.h"
+#include "rcmodel.h"
+#include "rcencoder.h"
+
+// Encoder that entropy codes symbols using coder E but bypasses it for
+// numbers, whose bits are packed verbatim into a separate byte sink in
+// little-endian order.  The low bits of prediction residuals are nearly
+// incompressible, so this trades no compression for much faster coding.
+template <class E>
+class RAWencoder {
+public:
+  RAWencoder(E* coder, RCencoder* sink) : coder(coder), sink(sink), buffer(0), count(0) {}
+
+  // discard pending bits for encoding another stream
+  void reset()
+  {
+    buffer = 0;
+    count = 0;
+  }
+
+  // finish encoding by flushing any partial byte
+  void finish();
+
+  // write a number s : 0 <= s < 2^n
+  template <typename UINT>
+  void encode(UINT s, uint n);
+
+  // encode a symbol s using probability model of concrete type R
+  template <class R>
+  void encode(uint s, R* rm) { coder->encode(s, rm); }
+
+private:
+  void put(uint s, uint n);
+
+  E*const         coder;  // entropy coder for symbols
+  RCencoder*const sink;   // destination of raw bits
+  uint64          buffer; // pending bits
+  uint            count;  // number of pending bits
+};
+
+#include "rawencoder.inl"
+
+#endif
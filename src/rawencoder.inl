@@ -0,0 +1,37 @@
+template <class E>
+inline void RAWencoder<E>::finish()
+{
+  for (uint i = 0; 8 * i < count; i++)
+    sink->putbyte((uint)(buffer >> (8 * i)) & 0xffu);
+  buffer = 0;
+  count = 0;
+}
+
+template <class E>
+template <typename UINT>
+inline void RAWencoder<E>::encode(UINT s, uint n)
+{
+  uint64 v = s;
+  if (sizeof(s) > 4 && n > 32) {
+    put((uint)v, 32);
+    v >>= 32;
+    n -= 32;
+  }
+  put((uint)v, n);
+}
+
+// append a number s : 0 <= s < 2^n <= 2^32
+template <class E>
+inline void RAWencoder<E>::put(uint s, uint n)
+{
+  buffer += (uint64)s << count;
+  count += n;
+  if (count >= 32) {
+    uchar byte[4];
+    for (uint i = 0; i < 4; i++)
+      byte[i] = (uchar)(buffer >> (8 * i));
+    sink->putbytes(byte, 4);
+    buffer >>= 32;
+    count -= 32;
+  }
+}
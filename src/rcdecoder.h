@@ -6,7 +6,7 @@
 
 class RCdecoder {
 public:
-  RCdecoder() : error(false), low(0), range(-1u), code(0) {}
+  RCdecoder() : error(false), ptr(0), end(0), low(0), range(-1u), code(0) {}
   virtual ~RCdecoder() {}
 
   // initialize decoding
@@ -23,17 +23,42 @@ public:
   template <typename UINT>
   UINT decode(UINT l, UINT h);
 
-  // decode a symbol using probability modeling
-  uint decode(RCmodel* rm);
+  // decode a symbol using probability model of concrete type R
+  template <class R>
+  uint decode(R* rm);
 
-  // virtual function for reading byte stream
-  virtual uint getbyte() = 0;
+  // read a byte from the stream
+  uint getbyte();
+
+  // read n raw bytes, bypassing entropy coding, and return pointer to them;
+  // the pointer remains valid until the next call; call init() before
+  // decoding any subsequent entropy coded data
+  virtual const uchar* getbytes(size_t n) = 0;
+
+  // skip n raw bytes
+  virtual void skipbytes(size_t n) { getbytes(n); }
 
   // number of bytes read
   virtual size_t bytes() const = 0;
 
   bool error;
 
+protected:
+  // virtual function for refilling an exhausted buffer; returns next byte
+  virtual uint underflow() = 0;
+
+  // reinitialize coder state for decoding another stream
+  void restart()
+  {
+    error = false;
+    low = 0;
+    range = -1u;
+    code = 0;
+  }
+
+  const uchar* ptr; // next byte in buffer
+  const uchar* end; // end of buffer
+
 private:
   uint decode_shift(uint n);
   uint decode_ratio(uint n);
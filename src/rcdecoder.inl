@@ -37,3 +37,60 @@ inline void RCdecoder::get(uint n)
     low <<= 8;
   }
 }
+
+// decode a symbol using probability modeling; the calls to the model
+// are qualified, which binds them statically so that they can be inlined
+template <class R>
+inline uint RCdecoder::decode(R* rm)
+{
+  rm->R::normalize(range);
+  uint l = (code - low) / range;
+  uint r;
+  uint s = rm->R::decode(l, r);
+  low += range * l;
+  range *= r;
+  normalize();
+  return s;
+}
+
+// decode a number s : 0 <= s < 2^n <= 2^16
+inline uint RCdecoder::decode_shift(uint n)
+{
+  range >>= n;
+  uint s = (code - low) / range;
+  low += range * s;
+  normalize();
+  return s;
+}
+
+// decode a number s : 0 <= s < n <= 2^16
+inline uint RCdecoder::decode_ratio(uint n)
+{
+  range /= n;
+  uint s = (code - low) / range;
+  low += range * s;
+  normalize();
+  return s;
+}
+
+// normalize the range and input data
+inline void RCdecoder::normalize()
+{
+  while (!((low ^ (low + range)) >> 24)) {
+    // top 8 bits are fixed; output them
+    get(1);
+    range <<= 8;
+  }
+  if (!(range >> 16)) {
+    // top 8 bits are not fixed but range is small;
+    // fudge range to avoid carry and input 16 bits
+    get(2);
+    range = -low;
+  }
+}
+
+// read a byte from the stream
+inline uint RCdecoder::getbyte()
+{
+  return ptr != end ? *ptr++ : underflow();
+}
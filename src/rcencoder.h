@@ -1,12 +1,13 @@
 #ifndef RC_ENCODER_H
 #define RC_ENCODER_H
 
+#include <cstring>
 #include "types.h"
 #include "rcmodel.h"
 
 class RCencoder {
 public:
-  RCencoder() : error(false), low(0), range(-1u) {}
+  RCencoder() : error(false), ptr(0), end(0), low(0), range(-1u) {}
   virtual ~RCencoder() {}
 
   // finish encoding
@@ -23,11 +24,15 @@ public:
   template <typename UINT>
   void encode(UINT s, UINT l, UINT h);
 
-  // encode a symbol s using probability modeling
-  void encode(uint s, RCmodel* rm);
+  // encode a symbol s using probability model of concrete type R
+  template <class R>
+  void encode(uint s, R* rm);
 
-  // virtual function for writing byte stream
-  virtual void putbyte(uint byte) = 0;
+  // write a byte to the stream
+  void putbyte(uint byte);
+
+  // write n raw bytes, bypassing entropy coding (call finish() first)
+  void putbytes(const void* data, size_t n);
 
   // flush out any buffered bytes
   virtual void flush() {}
@@ -37,6 +42,21 @@ public:
 
   bool error;
 
+protected:
+  // virtual function for writing n bytes that do not fit in the buffer
+  virtual void overflow(const void* data, size_t n) = 0;
+
+  // reinitialize coder state for encoding another stream
+  void restart()
+  {
+    error = false;
+    low = 0;
+    range = -1u;
+  }
+
+  uchar* ptr; // next free byte in buffer
+  uchar* end; // end of buffer
+
 private:
   void encode_shift(uint s, uint n);
   void encode_ratio(uint s, uint n);
@@ -38,3 +38,70 @@ inline void RCencoder::put(uint n)
     low <<= 8;
   }
 }
+
+// encode a symbol s using probability modeling; the calls to the model
+// are qualified, which binds them statically so that they can be inlined
+template <class R>
+inline void RCencoder::encode(uint s, R* rm)
+{
+  uint l, r;
+  rm->R::encode(s, l, r);
+  rm->R::normalize(range);
+  low += range * l;
+  range *= r;
+  normalize();
+}
+
+// encode a number s : 0 <= s < 2^n <= 2^16
+inline void RCencoder::encode_shift(uint s, uint n)
+{
+  range >>= n;
+  low += range * s;
+  normalize();
+}
+
+// encode a number s : 0 <= s < n <= 2^16
+inline void RCencoder::encode_ratio(uint s, uint n)
+{
+  range /= n;
+  low += range * s;
+  normalize();
+}
+
+// normalize the range and output data
+inline void RCencoder::normalize()
+{
+  while (!((low ^ (low + range)) >> 24)) {
+    // top 8 bits are fixed; output them
+    put(1);
+    range <<= 8;
+  }
+  if (!(range >> 16)) {
+    // top 8 bits are not fixed but range is small;
+    // fudge range to avoid carry and output 16 bits
+    put(2);
+    range = -low;
+  }
+}
+
+// write a byte to the stream
+inline void RCencoder::putbyte(uint byte)
+{
+  if (ptr != end)
+    *ptr++ = (uchar)byte;
+  else {
+    uchar b = (uchar)byte;
+    overflow(&b, 1);
+  }
+}
+
+// write n raw bytes
+inline void RCencoder::putbytes(const void* data, size_t n)
+{
+  if ((size_t)(end - ptr) >= n) {
+    memcpy(ptr, data, n);
+    ptr += n;
+  }
+  else
+    overflow(data, n);
+}
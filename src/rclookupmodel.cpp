@@ -0,0 +1,48 @@
+#include <stdexcept>
+#include "rclookupmodel.h"
+
+// log2 of number of table slots
+#define TBLBITS 12
+
+// the base model is constructed without its own search structure
+RClookupmodel::RClookupmodel(uint symbols, uint bits, uint period) : RCqsmodel(true, symbols, bits, period)
+{
+  if (symbols > 0x10000u)
+    throw std::domain_error("fpzip RClookupmodel too many symbols");
+
+  uint tblbits = bits < TBLBITS ? bits : TBLBITS;
+  slotshift = bits - tblbits;
+  first = new uint[symbols];
+  table = new ushort[1u << tblbits];
+  // force initial construction of entire table
+  for (uint s = 0; s < symbols; s++)
+    first[s] = -1u;
+  index();
+}
+
+RClookupmodel::~RClookupmodel()
+{
+  delete [] first;
+  delete [] table;
+}
+
+// update lookup table; symbol s occupies slots [first[s], first[s + 1]),
+// which need to be refilled only when either bound has moved
+void RClookupmodel::index()
+{
+  uint n = symbols;
+  uint next = cumf[n] >> slotshift;
+  bool moved = false;
+  for (uint s = n; s--; ) {
+    uint f = (cumf[s] + (1u << slotshift) - 1) >> slotshift;
+    if (f != first[s] || moved) {
+      for (uint k = f; k < next; k++)
+        table[k] = (ushort)s;
+      moved = (f != first[s]);
+      first[s] = f;
+    }
+    else
+      moved = false;
+    next = f;
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef RC_LOOKUPMODEL_H
+#define RC_LOOKUPMODEL_H
+
+#include "types.h"
+#include "rcqsmodel.h"
+
+// Quasistatic model for decompression that resolves each symbol directly
+// from the leading bits of its cumulative frequency.  A table partitions
+// the cumulative frequencies into equal-sized slots and records the symbol
+// at the start of each slot; since few slots contain more than one symbol,
+// at most a step or two beyond that symbol is needed.  The table is
+// updated incrementally on rescale.  Frequencies evolve exactly as in
+// RCqsmodel, whose encoder this model pairs with.
+class RClookupmodel : public RCqsmodel {
+public:
+  // initialization of model
+  // symbols:  number of symbols (must be <= 1<<16)
+  // bits:     log2 of total frequency count (must be <= 16)
+  // period:   max symbols between normalizations (must be < 1<<(bits+1))
+  RClookupmodel(uint symbols, uint bits = 16, uint period = 0x400);
+  ~RClookupmodel();
+
+  // return symbol corresponding to cumulative frequency l
+  uint decode(uint& l, uint& r);
+
+private:
+  void index();
+
+  uint    slotshift; // difference of frequency bits and table bits
+  uint*   first;     // first slot of each symbol
+  ushort* table;     // symbol at start of each slot
+};
+
+#include "rclookupmodel.inl"
+
+#endif
@@ -0,0 +1,13 @@
+// return symbol corresponding to cumulative frequency l
+inline uint RClookupmodel::decode(uint& l, uint& r)
+{
+  uint s = table[l >> slotshift];
+  while (cumf[s + 1] <= l)
+    s++;
+
+  l = cumf[s];
+  r = cumf[s + 1] - l;
+  update(s);
+
+  return s;
+}
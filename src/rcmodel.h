@@ -5,7 +5,7 @@
 
 class RCmodel {
 public:
-  RCmodel(uint symbols) : symbols(symbols) {}
+  RCmodel(uint symbols, uint bits) : symbols(symbols), bits(bits) {}
   virtual ~RCmodel() {}
 
   // get frequency r for a symbol s and cumulative frequency l
@@ -20,6 +20,7 @@ public:
   virtual void normalize(uint &r) = 0;
 
   const uint symbols; // number of symbols
+  const uint bits;    // log2 of sum of all frequency counts
 };
 
 #endif
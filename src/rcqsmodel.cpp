@@ -4,7 +4,7 @@
 // table size for binary search
 #define TBLSHIFT 7
 
-RCqsmodel::RCqsmodel(bool compress, uint symbols, uint bits, uint period) : RCmodel(symbols), bits(bits), targetrescale(period)
+RCqsmodel::RCqsmodel(bool compress, uint symbols, uint bits, uint period) : RCmodel(symbols, bits), targetrescale(period)
 {
   if (bits > 16)
     throw std::domain_error("fpzip RCqsmodel bits too large");
@@ -105,18 +105,15 @@ void RCqsmodel::update()
   more = count % rescale;
   left = rescale - more;
 
-  // build lookup table for fast symbol searches
+  index();
+}
+
+// build lookup table for fast symbol searches
+void RCqsmodel::index()
+{
+  uint n = symbols;
   if (search)
     for (uint i = n, h = 1 << TBLSHIFT; i--; h = cumf[i] >> searchshift)
       for (uint l = cumf[i] >> searchshift; l <= h; l++)
         search[l] = i;
 }
-
-// update frequency for symbol s
-void RCqsmodel::update(uint s)
-{
-  if (!left)
-    update();
-  left--;
-  symf[s] += incr;
-}
@@ -26,12 +26,13 @@ public:
   // normalize range
   void normalize(uint &r);
 
-private:
-
+protected:
+  // update probability table
   void update();
   void update(uint s);
 
-  const uint bits;     // number of bits of precision for frequencies
+  // build lookup table for fast symbol searches
+  virtual void index();
 
   uint  left;          // number of symbols until next normalization
   uint  more;          // number of symbols with larger increment
@@ -10,3 +10,12 @@ inline void RCqsmodel::normalize(uint& r)
 {
   r >>= bits;
 }
+
+// update frequency for symbol s
+inline void RCqsmodel::update(uint s)
+{
+  if (!left)
+    update();
+  left--;
+  symf[s] += incr;
+}
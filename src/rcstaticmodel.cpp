@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <stdexcept>
+#include "rcstaticmodel.h"
+
+RCstaticmodel::RCstaticmodel(bool compress, uint symbols, uint bits) : RCmodel(symbols, bits)
+{
+  if (bits > 16)
+    throw std::domain_error("fpzip RCstaticmodel bits too large");
+  if (symbols > (1u << bits))
+    throw std::domain_error("fpzip RCstaticmodel too many symbols");
+
+  uint n = symbols;
+  freq = new uint[n];
+  cumf = new uint[n + 1];
+  search = compress ? 0 : new ushort[1u << bits];
+  // start out with all frequency assigned to the first symbol
+  freq[0] = 1u << bits;
+  for (uint s = 1; s < n; s++)
+    freq[s] = 0;
+  update();
+}
+
+RCstaticmodel::~RCstaticmodel()
+{
+  delete [] freq;
+  delete [] cumf;
+  delete [] search;
+}
+
+// build model from symbol counts
+void RCstaticmodel::build(const uint64* count)
+{
+  uint n = symbols;
+  uint total = 1u << bits;
+  uint64 sum = 0;
+  for (uint s = 0; s < n; s++)
+    sum += count[s];
+  if (!sum) {
+    freq[0] = total;
+    for (uint s = 1; s < n; s++)
+      freq[s] = 0;
+    update();
+    return;
+  }
+
+  // scale counts to total, giving each occurring symbol a nonzero frequency
+  uint f = 0;
+  uint max = 0;
+  for (uint s = 0; s < n; s++) {
+    freq[s] = count[s] ? (uint)(count[s] * total / sum) : 0;
+    if (count[s] && !freq[s])
+      freq[s] = 1;
+    f += freq[s];
+    if (freq[s] > freq[max])
+      max = s;
+  }
+
+  // correct rounding error by adjusting largest frequencies
+  if (f < total)
+    freq[max] += total - f;
+  while (f > total) {
+    for (uint s = 0; s < n; s++)
+      if (freq[s] > freq[max])
+        max = s;
+    uint d = std::min(f - total, freq[max] - 1);
+    freq[max] -= d;
+    f -= d;
+  }
+
+  update();
+}
+
+// compute cumulative frequencies and lookup table
+void RCstaticmodel::update()
+{
+  uint n = symbols;
+  cumf[0] = 0;
+  for (uint s = 0; s < n; s++)
+    cumf[s + 1] = cumf[s] + freq[s];
+  if (search)
+    for (uint s = 0; s < n; s++)
+      for (uint l = cumf[s]; l < cumf[s + 1]; l++)
+        search[l] = (ushort)s;
+}
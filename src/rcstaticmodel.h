@@ -0,0 +1,51 @@
+#ifndef RC_STATICMODEL_H
+#define RC_STATICMODEL_H
+
+#include "types.h"
+#include "rcmodel.h"
+
+// Semi-static model whose symbol frequencies are fixed for the duration
+// of coding.  The encoder builds the model from symbol counts gathered in
+// a prior pass and writes its frequency table to the stream, from which
+// the decoder reconstructs the model.  Decoding looks symbols up directly
+// in a table indexed by cumulative frequency.
+class RCstaticmodel : public RCmodel {
+public:
+  // initialization of model
+  // compress: true for compression, false for decompression
+  // symbols:  number of symbols
+  // bits:     log2 of total frequency count (must be <= 16)
+  RCstaticmodel(bool compress, uint symbols, uint bits = 12);
+  ~RCstaticmodel();
+
+  // build model from symbol counts
+  void build(const uint64* count);
+
+  // write frequency table using entropy encoder re
+  template <class E>
+  void write(E* re) const;
+
+  // read frequency table using entropy decoder rd
+  template <class D>
+  void read(D* rd);
+
+  // get frequencies for a symbol s
+  void encode(uint s, uint& l, uint& r);
+
+  // return symbol corresponding to cumulative frequency l
+  uint decode(uint& l, uint& r);
+
+  // normalize range
+  void normalize(uint &r);
+
+private:
+  void update();
+
+  uint*   freq;   // array of symbol frequencies
+  uint*   cumf;   // array of cumulative frequencies
+  ushort* search; // symbol for each cumulative frequency
+};
+
+#include "rcstaticmodel.inl"
+
+#endif
@@ -0,0 +1,72 @@
+#include <stdexcept>
+
+// write range of symbols with nonzero frequency, followed by each
+// frequency f in that range as its bit length n and n - 1 low bits
+template <class E>
+void RCstaticmodel::write(E* re) const
+{
+  uint first = 0;
+  while (!freq[first])
+    first++;
+  uint last = symbols - 1;
+  while (!freq[last])
+    last--;
+  re->encode(first, 16);
+  re->encode(last, 16);
+  for (uint s = first; s <= last; s++) {
+    uint f = freq[s];
+    uint n = 0;
+    while (f >> n)
+      n++;
+    re->encode(n, 5);
+    if (n > 1)
+      re->encode(f - (1u << (n - 1)), n - 1);
+  }
+}
+
+// read frequency table written by write()
+template <class D>
+void RCstaticmodel::read(D* rd)
+{
+  uint first = rd->template decode<uint>(16);
+  uint last = rd->template decode<uint>(16);
+  if (first > last || last >= symbols)
+    throw std::runtime_error("fpzip RCstaticmodel invalid symbol range");
+  uint sum = 0;
+  for (uint s = 0; s < symbols; s++) {
+    uint f = 0;
+    if (first <= s && s <= last) {
+      uint n = rd->template decode<uint>(5);
+      if (n > bits + 1)
+        throw std::runtime_error("fpzip RCstaticmodel invalid frequency");
+      if (n)
+        f = (1u << (n - 1)) + (n > 1 ? rd->template decode<uint>(n - 1) : 0);
+    }
+    freq[s] = f;
+    sum += f;
+  }
+  if (sum != 1u << bits)
+    throw std::runtime_error("fpzip RCstaticmodel invalid frequency table");
+  update();
+}
+
+// get frequencies for a symbol s
+inline void RCstaticmodel::encode(uint s, uint& l, uint& r)
+{
+  l = cumf[s];
+  r = cumf[s + 1] - l;
+}
+
+// return symbol corresponding to cumulative frequency l
+inline uint RCstaticmodel::decode(uint& l, uint& r)
+{
+  uint s = search[l];
+  l = cumf[s];
+  r = cumf[s + 1] - l;
+  return s;
+}
+
+inline void RCstaticmodel::normalize(uint& r)
+{
+  r >>= bits;
+}
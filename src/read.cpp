@@ -1,209 +1,945 @@
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#ifdef FPZIP_WITH_OPENMP
+#include <omp.h>
+#endif
 #include "pcdecoder.h"
-#include "rcqsmodel.h"
+#include "ansdecoder.h"
+#include "rawdecoder.h"
+#include "rclookupmodel.h"
+#include "rcstaticmodel.h"
 #include "front.h"
 #include "fpzip.h"
 #include "codec.h"
+#include "batch.h"
+#include "chunk.h"
+#include "coding.h"
+#include "context.h"
+#include "filemap.h"
 #include "read.h"
+#include "reuse.h"
+
+class FieldDecoder;
 
 // array meta data and decoder
 struct FPZinput : public FPZ {
   RCdecoder* rd;
+  FileMap* map;            // mapped input file, if any
+  bool resume;             // decoder must be reinitialized before decoding next array
+  uint64 slice;            // number of slices decompressed incrementally
+  FieldDecoder* field;     // cache while a field is partially decompressed, else null
+  FieldDecoder* cache;     // decoder of most recent field, kept for reuse
+  fpzip_context* context;  // context that recycles stream, if any
+  std::vector<BatchItem>* batch; // meta data of batch whose header was read, if any
 };
 
+// set meta data and state of input stream to their defaults
+static void
+reset_input(
+  FPZinput* stream // input stream
+)
+{
+  stream->type = FPZIP_TYPE_FLOAT;
+  stream->prec = 0;
+  stream->nx = stream->ny = stream->nz = stream->nf = 1;
+  stream->cx = stream->cy = stream->cz = 0;
+  stream->lanes = 0;
+  stream->coder = FPZIP_CODER_RANGE;
+  stream->model = FPZIP_MODEL_ADAPTIVE;
+  stream->bypass = 0;
+  stream->predictor = FPZIP_PREDICTOR_LORENZO;
+  stream->threads = 0;
+  stream->resume = false;
+  stream->slice = 0;
+  stream->field = 0;
+  delete stream->batch;
+  stream->batch = 0;
+}
+
 // allocate input stream
 static FPZinput*
 allocate_input()
 {
   FPZinput* stream = new FPZinput;
-  stream->type = FPZIP_TYPE_FLOAT;
-  stream->prec = 0;
-  stream->nx = stream->ny = stream->nz = stream->nf = 1;
+  stream->batch = 0;
+  reset_input(stream);
   stream->rd = 0;
+  stream->map = 0;
+  stream->cache = 0;
+  stream->context = 0;
   return stream;
 }
 
+// residual decoders for samples distributed round-robin over lanes
+template <typename T, class M, class D>
+class LaneDecoder {
+public:
+  typedef PCdecoder<T, M, D> Decoder;
+  typedef typename Decoder::Residual Residual;
+
+  // use models of given kind; semi-static models are read from the lanes,
+  // while context-selected models track the activity of rows of nx samples
+  // in planes of ny rows
+  LaneDecoder(D*const* rd, uint n, uint model, size_t nx, size_t ny) :
+    rd(rd), n(n), i(0), model(model),
+    cx(model == FPZIP_MODEL_CONTEXT ? new Context(Decoder::symbols, M::bits > PC_BIT_MAX, nx, ny) : 0),
+    rm(n * (cx ? Context::count : 1)), fd(n)
+  {
+    uint contexts = cx ? Context::count : 1;
+    for (uint k = 0; k < n; k++) {
+      for (uint c = 0; c < contexts; c++) {
+        RCmodel*& m = rm[k * contexts + c];
+        if (model == FPZIP_MODEL_STATIC) {
+          RCstaticmodel* sm = new RCstaticmodel(false, Decoder::symbols);
+          m = sm;
+          sm->read(rd[k]);
+        }
+        else
+          m = new RClookupmodel(Decoder::symbols);
+      }
+      fd[k] = new Decoder(rd[k], &rm[k * contexts]);
+    }
+  }
+
+  ~LaneDecoder()
+  {
+    for (uint k = 0; k < n; k++)
+      delete fd[k];
+    for (uint k = 0; k < rm.size(); k++)
+      delete rm[k];
+    delete cx;
+  }
+
+  // reinitialize models in place for decoding another array; semi-static
+  // models are read anew from the lanes, and adaptive models keep their
+  // statistics when warm
+  void reset(bool warm)
+  {
+    i = 0;
+    if (cx)
+      cx->reset();
+    uint contexts = cx ? Context::count : 1;
+    for (uint k = 0; k < n; k++)
+      for (uint c = 0; c < contexts; c++) {
+        RCmodel* m = rm[k * contexts + c];
+        if (model == FPZIP_MODEL_STATIC)
+          static_cast<RCstaticmodel*>(m)->read(rd[k]);
+        else if (warm)
+          continue;
+        else
+          static_cast<RClookupmodel*>(m)->reset();
+      }
+  }
+
+  // decode residuals of next row of m samples; consecutive samples belong
+  // to different lanes and their decoding may overlap in time; the models
+  // are called through their concrete type so that the per-sample decoding
+  // path is compiled without virtual calls
+  void decode(Residual* d, size_t m)
+  {
+    switch (model) {
+      case FPZIP_MODEL_STATIC:
+        decode_residual<RCstaticmodel>(d, m);
+        break;
+      default:
+        decode_residual<RClookupmodel>(d, m);
+        break;
+    }
+  }
+
+  // reconstruct value from its prediction and residual; a single lane is
+  // decoded on demand, as there is no overlap to gain from decoding ahead
+  T reconstruct(T pred, const Residual& d)
+  {
+    if (n > 1 || cx)
+      return Decoder::reconstruct(pred, d);
+    switch (model) {
+      case FPZIP_MODEL_STATIC:
+        return fd[0]->template decode<RCstaticmodel>(pred);
+      default:
+        return fd[0]->template decode<RClookupmodel>(pred);
+    }
+  }
+
+private:
+  // decode row using models of type R
+  template <class R>
+  void decode_residual(Residual* d, size_t m)
+  {
+    if (cx) {
+      cx->advance();
+      for (size_t x = 0; x < m; x++) {
+        d[x] = fd[i]->template decode_residual<R>((*cx)(x));
+        cx->update(x, Decoder::symbol(d[x]));
+        if (++i == n)
+          i = 0;
+      }
+    }
+    else if (n > 1) {
+      for (size_t x = 0; x < m; x++) {
+        d[x] = fd[i]->template decode_residual<R>();
+        if (++i == n)
+          i = 0;
+      }
+    }
+  }
+
+  D*const*const          rd;    // entropy decoder for each lane
+  const uint             n;     // number of lanes
+  uint                   i;     // index of next lane
+  const uint             model; // kind of probability model
+  Context*const          cx;    // model selector, if any
+  std::vector<RCmodel*>  rm;    // probability models for each lane and context
+  std::vector<Decoder*>  fd;    // residual decoder for each lane
+};
+
+// decompresses consecutive planes of a 3D array, keeping the state of its
+// front of reconstructed samples and entropy decoders between calls
+class SliceDecoder {
+public:
+  virtual ~SliceDecoder() {}
+
+  // decompress nz more planes to data
+  virtual void decode(void* data, size_t nz) = 0;
+
+  // start over with another array, reusing buffers and models; warm
+  // adaptive models continue from the statistics of the previous array
+  virtual void reset(bool warm) = 0;
+};
+
+#if FPZIP_FP == FPZIP_FP_EMUL
+#include "fpe.h"
+#endif
+
+// slice decoder for arrays of type T at given precision using decoders D
+template <typename T, uint bits, class D>
+class SliceDecoderImpl : public SliceDecoder {
+public:
 #if FPZIP_FP == FPZIP_FP_FAST || FPZIP_FP == FPZIP_FP_SAFE
-// decompress 3D array at specified precision using floating-point arithmetic
-template <typename T, uint bits>
-static void
-decompress3d(
-  RCdecoder* rd,   // entropy decoder
-  T*         data, // flattened 3D array to decompress to
-  uint       nx,   // number of x samples
-  uint       ny,   // number of y samples
-  uint       nz    // number of z samples
-)
-{
-  // initialize decompressor
+  // predict using floating-point arithmetic
   typedef PCmap<T, bits> Map;
-  RCmodel* rm = new RCqsmodel(false, PCdecoder<T, Map>::symbols);
-  PCdecoder<T, Map>* fd = new PCdecoder<T, Map>(rd, &rm);
-  Front<T> f(nx, ny);
-
-  // decode difference between predicted (p) and actual (a) value
-  uint x, y, z;
-  for (z = 0, f.advance(0, 0, 1); z < nz; z++)
-    for (y = 0, f.advance(0, 1, 0); y < ny; y++)
-      for (x = 0, f.advance(1, 0, 0); x < nx; x++) {
-        #if FPZIP_FP == FPZIP_FP_SAFE
-        volatile T p = f(1, 1, 1);
-        p += f(1, 0, 0);
-        p -= f(0, 1, 1);
-        p += f(0, 1, 0);
-        p -= f(1, 0, 1);
-        p += f(0, 0, 1);
-        p -= f(1, 1, 0);
-        #else
-        T p = f(1, 0, 0) - f(0, 1, 1) +
-              f(0, 1, 0) - f(1, 0, 1) +
-              f(0, 0, 1) - f(1, 1, 0) +
-              f(1, 1, 1);
-        #endif
-        T a = fd->decode(p);
-        *data++ = a;
-        f.push(a);
+  typedef T V;
+  typedef LaneDecoder<T, Map, D> Decoder;
+#elif FPZIP_FP == FPZIP_FP_EMUL
+  // predict using floating-point emulation
+  typedef PCmap<T, bits> Map;
+  typedef FPE<T> V;
+  typedef LaneDecoder<T, Map, D> Decoder;
+#else // FPZIP_FP_INT
+  // predict using integer arithmetic
+  typedef PCmap<T, bits> TMap;
+  typedef typename TMap::Range U;
+  typedef PCmap<U, bits, U> Map;
+  typedef U V;
+  typedef LaneDecoder<U, Map, D> Decoder;
+#endif
+
+  SliceDecoderImpl(D*const* rd, const Coding& coding, size_t nx, size_t ny, size_t sy, size_t sz) :
+    rd(rd), adaptive(coding.adaptive), nx(nx), ny(ny), sy(sy), sz(sz), fd(rd, coding.lanes, coding.model, nx, ny), d(nx),
+#if FPZIP_FP == FPZIP_FP_INT
+    f(nx, ny, TMap().forward(0))
+#else
+    f(nx, ny)
+#endif
+  {
+    f.advance(0, 0, 1);
+  }
+
+  void reset(bool warm)
+  {
+    fd.reset(warm);
+    f.reset();
+    f.advance(0, 0, 1);
+  }
+
+  void decode(void* data, size_t nz)
+  {
+    T* p = static_cast<T*>(data);
+    // the predictor selected for each row precedes it in the first lane
+    size_t y, z;
+    for (z = 0; z < nz; z++, p += sz - ny * sy)
+      for (y = 0, f.advance(0, 1, 0); y < ny; y++, p += sy - nx) {
+        uint kind = adaptive ? rd[0]->template decode<uint>(FPZ_PRED_BITS) : FPZ_PRED_LORENZO;
+        fd.decode(&d[0], nx);
+        f.advance(1, 0, 0);
+        switch (kind) {
+          case FPZ_PRED_LORENZO:
+            p = decode_row<FPZ_PRED_LORENZO>(p);
+            break;
+          case FPZ_PRED_PLANE:
+            p = decode_row<FPZ_PRED_PLANE>(p);
+            break;
+          case FPZ_PRED_PREV:
+            p = decode_row<FPZ_PRED_PREV>(p);
+            break;
+          default:
+            p = decode_row<FPZ_PRED_LINEAR>(p);
+            break;
+        }
       }
+  }
 
-  delete fd;
-  delete rm;
-}
+private:
+  // decode difference between predicted (p) and actual (a) value for the
+  // samples of a row using given predictor and return end of row
+  template <uint kind>
+  T* decode_row(T* p)
+  {
+#if FPZIP_FP == FPZIP_FP_INT
+    TMap map;
+#endif
+    for (size_t x = 0; x < nx; x++) {
+#if FPZIP_FP == FPZIP_FP_FAST || FPZIP_FP == FPZIP_FP_SAFE
+      T a = fd.reconstruct(predict<kind>(), d[x]);
+      *p++ = a;
 #elif FPZIP_FP == FPZIP_FP_EMUL
-#include "fpe.h"
-// decompress 3D array at specified precision using floating-point emulation
-template <typename T, uint bits>
-static void
+      T a = fd.reconstruct(T(predict<kind>()), d[x]);
+      *p++ = a;
+#else
+      U a = fd.reconstruct(predict<kind>(), d[x]);
+      *p++ = map.inverse(a);
+#endif
+      f.push(a);
+    }
+    return p;
+  }
+
+  // prediction of current sample from its neighbors in the front, which
+  // must match the encoder's row kernels operation for operation
+  template <uint kind>
+  V predict() const
+  {
+#if FPZIP_FP == FPZIP_FP_SAFE
+    volatile T q;
+    switch (kind) {
+      case FPZ_PRED_LORENZO:
+        q = f(1, 1, 1);
+        q += f(1, 0, 0);
+        q -= f(0, 1, 1);
+        q += f(0, 1, 0);
+        q -= f(1, 0, 1);
+        q += f(0, 0, 1);
+        q -= f(1, 1, 0);
+        break;
+      case FPZ_PRED_PLANE:
+        q = f(1, 0, 0);
+        q -= f(1, 1, 0);
+        q += f(0, 1, 0);
+        break;
+      case FPZ_PRED_PREV:
+        q = f(1, 0, 0);
+        break;
+      default:
+        q = f(1, 0, 0);
+        q += f(1, 0, 0);
+        q -= f(2, 0, 0);
+        break;
+    }
+    return q;
+#else
+    switch (kind) {
+      case FPZ_PRED_LORENZO:
+        return f(1, 0, 0) - f(0, 1, 1) +
+               f(0, 1, 0) - f(1, 0, 1) +
+               f(0, 0, 1) - f(1, 1, 0) +
+               f(1, 1, 1);
+      case FPZ_PRED_PLANE:
+        return f(1, 0, 0) - f(1, 1, 0) + f(0, 1, 0);
+      case FPZ_PRED_PREV:
+        return f(1, 0, 0);
+      default:
+        return f(1, 0, 0) + f(1, 0, 0) - f(2, 0, 0);
+    }
+#endif
+  }
+
+  D*const*const                           rd;       // entropy decoder for each lane
+  const bool                              adaptive; // is the predictor selected per row?
+  const size_t                            nx;       // number of x samples
+  const size_t                            ny;       // number of y samples
+  const size_t                            sy;       // distance between consecutive rows
+  const size_t                            sz;       // distance between consecutive planes
+  Decoder                                 fd;       // residual decoders
+  std::vector<typename Decoder::Residual> d;        // residuals of current row
+  Front<V>                                f;        // front of reconstructed samples
+};
+
+// construct slice decoder for p-bit float, 2p-bit double
+#define slice_decoder_case(p)\
+  case subsize(T, p):\
+    return new SliceDecoderImpl<T, subsize(T, p), D>(rd, coding, nx, ny, sy, sz)
+
+// construct slice decoder for 3D arrays of type T at given precision
+template <typename T, class D>
+static SliceDecoder*
+slice_decoder(
+  D*const*      rd,     // entropy decoder for each lane
+  const Coding& coding, // entropy coding options
+  int           bits,   // number of bits of precision
+  size_t        nx,     // number of x samples
+  size_t        ny,     // number of y samples
+  size_t        sy,     // distance between consecutive rows
+  size_t        sz      // distance between consecutive planes
+)
+{
+  switch (bits) {
+    slice_decoder_case( 2);
+    slice_decoder_case( 3);
+    slice_decoder_case( 4);
+    slice_decoder_case( 5);
+    slice_decoder_case( 6);
+    slice_decoder_case( 7);
+    slice_decoder_case( 8);
+    slice_decoder_case( 9);
+    slice_decoder_case(10);
+    slice_decoder_case(11);
+    slice_decoder_case(12);
+    slice_decoder_case(13);
+    slice_decoder_case(14);
+    slice_decoder_case(15);
+    slice_decoder_case(16);
+    slice_decoder_case(17);
+    slice_decoder_case(18);
+    slice_decoder_case(19);
+    slice_decoder_case(20);
+    slice_decoder_case(21);
+    slice_decoder_case(22);
+    slice_decoder_case(23);
+    slice_decoder_case(24);
+    slice_decoder_case(25);
+    slice_decoder_case(26);
+    slice_decoder_case(27);
+    slice_decoder_case(28);
+    slice_decoder_case(29);
+    slice_decoder_case(30);
+    slice_decoder_case(31);
+    slice_decoder_case(32);
+    default:
+      return 0;
+  }
+}
+
+// is precision (in bits) supported for type T?
+template <typename T>
+static bool
+valid_precision(int bits)
+{
+  return (int)subsize(T, 2) <= bits && bits <= (int)subsize(T, 32) && !(bits % (int)subsize(T, 1));
+}
+
+// is precision (in bits) supported for arrays of given type?
+static bool
+valid_precision(int type, int bits)
+{
+  return type == FPZIP_TYPE_FLOAT ? valid_precision<float>(bits) : valid_precision<double>(bits);
+}
+
+// Decompresses a 3D array from a range decoder a number of planes at a
+// time.  Multiple lanes, rANS coded lanes, and lanes with raw bits are coded
+// separately and follow a table of their sizes, which are fetched in their
+// entirety before decoding begins; rd must then be reinitialized before
+// decoding any further data.  Once done, the decoder may be reset to decode
+// another array with the same layout and coding options.
+class FieldDecoder {
+public:
+  FieldDecoder(RCdecoder* rd, const Coding& coding, int type, int bits, size_t nx, size_t ny, size_t sy, size_t sz) :
+    rd(rd), coding(coding), type(type), bits(bits), nx(nx), ny(ny), sy(sy), sz(sz),
+    precise(valid_precision(type, bits)), ready(false), slices(0)
+  {
+    reset(rd, false);
+  }
+
+  ~FieldDecoder() { release(); }
+
+  // is the precision supported?
+  bool valid() const { return precise; }
+
+  // does the decoder decompress arrays with the given layout and options?
+  bool matches(const Coding& coding, int type, int bits, size_t nx, size_t ny, size_t sy, size_t sz) const
+  {
+    return this->coding == coding && this->type == type && this->bits == bits &&
+           this->nx == nx && this->ny == ny && this->sy == sy && this->sz == sz;
+  }
+
+  // start decoding an array from rd, reusing any decoders and models of the
+  // previous array, whose adaptive models carry over when warm
+  void reset(RCdecoder* rd, bool warm)
+  {
+    this->rd = rd;
+    ready = false;
+    if (!precise)
+      return;
+    if (!coding.separate()) {
+      if (slices)
+        slices->reset(warm);
+      else
+        slices = create(&this->rd);
+      ready = true;
+      return;
+    }
+
+    // read table of stream sizes and fetch streams
+    const uint streams = coding.streams();
+    offset.resize(streams + 1);
+    offset[0] = 0;
+    for (uint i = 0; i < streams; i++)
+      offset[i + 1] = offset[i] + rd->decode<uint64>(64);
+    const uchar* buffer = rd->getbytes(offset[streams]);
+    if (rd->error)
+      return;
+
+    // decode lanes in interleaved order
+    try {
+      if (coding.coder == FPZIP_CODER_RANS)
+        open(buffer, ald, abd, warm);
+      else
+        open(buffer, rld, rbd, warm);
+    }
+    catch (...) {
+      release();
+      throw;
+    }
+    ready = true;
+  }
+
+  // decompress nz more planes to data
+  void decode(void* data, size_t nz)
+  {
+    if (ready)
+      slices->decode(data, nz);
+  }
+
+  // finish decompression once all planes have been decompressed; each
+  // separately coded stream must have been consumed in its entirety
+  void finish()
+  {
+    if (ready && (!consumed(rld, rbd) || !consumed(ald, abd)))
+      rd->error = true;
+  }
+
+private:
+  FieldDecoder(const FieldDecoder&);
+  FieldDecoder& operator=(const FieldDecoder&);
+
+  // construct slice decoder for arrays of given type using decoders d
+  template <class D>
+  SliceDecoder* create(D*const* d) const
+  {
+    return type == FPZIP_TYPE_FLOAT
+      ? slice_decoder<float, D>(d, coding, bits, nx, ny, sy, sz)
+      : slice_decoder<double, D>(d, coding, bits, nx, ny, sy, sz);
+  }
+
+  // open lanes stored back to back in buffer, followed by the raw bits of
+  // each lane when bypassing the entropy coder; existing decoders are
+  // pointed at the new lanes
+  template <class D>
+  void open(const uchar* buffer, std::vector<D*>& ld, std::vector<RAWdecoder<D>*>& bd, bool warm)
+  {
+    const uint lanes = coding.lanes;
+    if (ld.empty()) {
+      for (uint i = 0; i < lanes; i++)
+        ld.push_back(new D(buffer + offset[i]));
+      if (coding.bypass)
+        for (uint i = 0; i < lanes; i++)
+          bd.push_back(new RAWdecoder<D>(ld[i], buffer + offset[lanes + i], offset[lanes + i + 1] - offset[lanes + i]));
+    }
+    else {
+      for (uint i = 0; i < lanes; i++)
+        ld[i]->open(buffer + offset[i]);
+      for (uint i = 0; i < bd.size(); i++)
+        bd[i]->open(buffer + offset[lanes + i], offset[lanes + i + 1] - offset[lanes + i]);
+    }
+    for (uint i = 0; i < lanes; i++)
+      ld[i]->init();
+    if (slices)
+      slices->reset(warm);
+    else
+      slices = coding.bypass ? create(&bd[0]) : create(&ld[0]);
+  }
+
+  // have lanes and their raw bits been consumed in their entirety?
+  template <class D>
+  bool consumed(const std::vector<D*>& ld, const std::vector<RAWdecoder<D>*>& bd) const
+  {
+    const uint lanes = coding.lanes;
+    for (uint i = 0; i < bd.size(); i++)
+      if (bd[i]->bytes() != offset[lanes + i + 1] - offset[lanes + i])
+        return false;
+    for (uint i = 0; i < ld.size(); i++)
+      if (ld[i]->bytes() != offset[i + 1] - offset[i])
+        return false;
+    return true;
+  }
+
+  // deallocate decoders
+  void release()
+  {
+    delete slices;
+    slices = 0;
+    for (uint i = 0; i < abd.size(); i++)
+      delete abd[i];
+    for (uint i = 0; i < rbd.size(); i++)
+      delete rbd[i];
+    for (uint i = 0; i < ald.size(); i++)
+      delete ald[i];
+    for (uint i = 0; i < rld.size(); i++)
+      delete rld[i];
+    abd.clear();
+    rbd.clear();
+    ald.clear();
+    rld.clear();
+  }
+
+  RCdecoder*                              rd;      // entropy decoder of stream
+  const Coding                            coding;  // entropy coding options
+  const int                               type;    // type of array
+  const int                               bits;    // number of bits of precision
+  const size_t                            nx;      // number of x samples
+  const size_t                            ny;      // number of y samples
+  const size_t                            sy;      // distance between consecutive rows
+  const size_t                            sz;      // distance between consecutive planes
+  const bool                              precise; // is precision supported?
+  bool                                    ready;   // are decoders set up for current array?
+  std::vector<size_t>                     offset;  // offset of each stream and end of last
+  std::vector<RCmemdecoder*>              rld;     // range decoder for each lane
+  std::vector<ANSdecoder*>                ald;     // rANS decoder for each lane
+  std::vector<RAWdecoder<RCmemdecoder>*>  rbd;     // range and raw bit decoders
+  std::vector<RAWdecoder<ANSdecoder>*>    abd;     // rANS and raw bit decoders
+  SliceDecoder*                           slices;  // decoder of planes
+};
+
+// decompress 3D (sub)array of given type at given precision
+static bool
 decompress3d(
-  RCdecoder* rd,   // entropy encoder
-  T*         data, // flattened 3D array to decompress to
-  uint       nx,   // number of x samples
-  uint       ny,   // number of y samples
-  uint       nz    // number of z samples
+  RCdecoder*    rd,     // entropy decoder
+  int           type,   // type of array
+  void*         data,   // first sample of 3D array to decompress to
+  int           bits,   // number of bits of precision
+  const Coding& coding, // entropy coding options
+  size_t        nx,     // number of x samples
+  size_t        ny,     // number of y samples
+  size_t        nz,     // number of z samples
+  size_t        sy,     // distance between consecutive rows
+  size_t        sz      // distance between consecutive planes
 )
 {
-  // initialize decompressor
-  typedef PCmap<T, bits> Map;
-  typedef FPE<T> Float;
-  RCmodel* rm = new RCqsmodel(false, PCdecoder<T, Map>::symbols);
-  PCdecoder<T, Map>* fd = new PCdecoder<T, Map>(rd, &rm);
-  Front<Float> f(nx, ny);
-
-  // decode difference between predicted (p) and actual (a) value
-  uint x, y, z;
-  for (z = 0, f.advance(0, 0, 1); z < nz; z++)
-    for (y = 0, f.advance(0, 1, 0); y < ny; y++)
-      for (x = 0, f.advance(1, 0, 0); x < nx; x++) {
-        Float p = f(1, 0, 0) - f(0, 1, 1) +
-                  f(0, 1, 0) - f(1, 0, 1) +
-                  f(0, 0, 1) - f(1, 1, 0) +
-                  f(1, 1, 1);
-        T a = fd->decode(T(p));
-        *data++ = a;
-        f.push(a);
-      }
-                                                                                
-  delete fd;
-  delete rm;
+  FieldDecoder field(rd, coding, type, bits, nx, ny, sy, sz);
+  if (!field.valid())
+    return false;
+  field.decode(data, nz);
+  field.finish();
+  return true;
 }
-#else // FPZIP_FP_INT
-// decompress 3D array at specified precision using integer arithmetic
-template <typename T, uint bits>
+
+// decoder of next field of stream, which reuses the decoder of the
+// previous field when the array layout and coding options are unchanged
+static FieldDecoder*
+field_decoder(
+  FPZinput*     stream, // input stream
+  const Coding& coding, // entropy coding options
+  int           bits    // number of bits of precision
+)
+{
+  const size_t nx = stream->nx;
+  const size_t ny = stream->ny;
+  const size_t sy = nx;
+  const size_t sz = nx * ny;
+  if (stream->cache && stream->cache->matches(coding, stream->type, bits, nx, ny, sy, sz))
+    stream->cache->reset(stream->rd, false);
+  else {
+    delete stream->cache;
+    stream->cache = 0;
+    stream->cache = new FieldDecoder(stream->rd, coding, stream->type, bits, nx, ny, sy, sz);
+  }
+  return stream->cache;
+}
+
+// skip 3D array coded using separate streams
 static void
-decompress3d(
-  RCdecoder* rd,   // entropy decoder
-  T*         data, // flattened 3D array to decompress to
-  uint       nx,   // number of x samples
-  uint       ny,   // number of y samples
-  uint       nz    // number of z samples
+skip3d(
+  RCdecoder* rd,     // entropy decoder
+  uint       streams // number of streams
 )
 {
-  // initialize decompressor
-  typedef PCmap<T, bits> TMap;
-  typedef typename TMap::Range U;
-  typedef PCmap<U, bits, U> UMap;
-  RCmodel* rm = new RCqsmodel(false, PCdecoder<U, UMap>::symbols);
-  PCdecoder<U, UMap>* fd = new PCdecoder<U, UMap>(rd, &rm);
-  TMap map;
-  Front<U> f(nx, ny, map.forward(0));
-
-  // decode difference between predicted (p) and actual (a) value
-  uint x, y, z;
-  for (z = 0, f.advance(0, 0, 1); z < nz; z++)
-    for (y = 0, f.advance(0, 1, 0); y < ny; y++)
-      for (x = 0, f.advance(1, 0, 0); x < nx; x++) {
-        U p = f(1, 0, 0) - f(0, 1, 1) +
-              f(0, 1, 0) - f(1, 0, 1) +
-              f(0, 0, 1) - f(1, 1, 0) +
-              f(1, 1, 1);
-        U a = fd->decode(p);
-        *data++ = map.inverse(a);
-        f.push(a);
-      }
+  size_t size = 0;
+  for (uint i = 0; i < streams; i++)
+    size += rd->decode<uint64>(64);
+  rd->skipbytes(size);
+}
 
-  delete fd;
-  delete rm;
+// resume range decoding following a previously decoded array
+static RCdecoder*
+resume(FPZinput* stream)
+{
+  if (stream->resume) {
+    stream->rd->init();
+    stream->resume = false;
+  }
+  return stream->rd;
 }
-#endif
 
-// decompress p-bit float, 2p-bit double
-#define decompress_case(p)\
-  case subsize(T, p):\
-    decompress3d<T, subsize(T, p)>(stream->rd, data, stream->nx, stream->ny, stream->nz);\
-    break
+// subarray of samples [x0, x0 + nx) * [y0, y0 + ny) * [z0, z0 + nz) of
+// fields [f0, f1) to decompress
+struct Box {
+  bool contains(size_t x, size_t y, size_t z, size_t sx, size_t sy, size_t sz) const
+  {
+    return x0 <= x && x + sx <= x0 + nx &&
+           y0 <= y && y + sy <= y0 + ny &&
+           z0 <= z && z + sz <= z0 + nz;
+  }
+  bool overlaps(size_t x, size_t y, size_t z, size_t sx, size_t sy, size_t sz) const
+  {
+    return x < x0 + nx && x0 < x + sx &&
+           y < y0 + ny && y0 < y + sy &&
+           z < z0 + nz && z0 < z + sz;
+  }
+  size_t x0, y0, z0, f0; // first sample and field
+  size_t nx, ny, nz, f1; // box dimensions and one past last field
+};
 
-// decompress 4D array
+// copy box of nx * ny * nz samples between strided 3D arrays
+template <typename T>
+static void
+copy3d(
+  T*       dst, // first sample of destination array
+  size_t   dy,  // distance between consecutive destination rows
+  size_t   dz,  // distance between consecutive destination planes
+  const T* src, // first sample of source array
+  size_t   sy,  // distance between consecutive source rows
+  size_t   sz,  // distance between consecutive source planes
+  size_t   nx,  // number of x samples
+  size_t   ny,  // number of y samples
+  size_t   nz   // number of z samples
+)
+{
+  for (size_t z = 0; z < nz; z++)
+    for (size_t y = 0; y < ny; y++)
+      std::copy(src + y * sy + z * sz, src + y * sy + z * sz + nx, dst + y * dy + z * dz);
+}
+
+// decompress box of 4D array
 template <typename T>
 static bool
 decompress4d(
-  FPZinput* stream, // input stream
-  T*        data    // flattened 4D array to decompress to
+  FPZinput*  stream, // input stream
+  T*         data,   // flattened 4D array of box samples to decompress to
+  const Box& box     // subarray to decompress
 )
 {
-  // decompress one field at a time
-  for (int i = 0; i < stream->nf; i++) {
-    int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * sizeof(T));
-    switch (bits) {
-      decompress_case( 2);
-      decompress_case( 3);
-      decompress_case( 4);
-      decompress_case( 5);
-      decompress_case( 6);
-      decompress_case( 7);
-      decompress_case( 8);
-      decompress_case( 9);
-      decompress_case(10);
-      decompress_case(11);
-      decompress_case(12);
-      decompress_case(13);
-      decompress_case(14);
-      decompress_case(15);
-      decompress_case(16);
-      decompress_case(17);
-      decompress_case(18);
-      decompress_case(19);
-      decompress_case(20);
-      decompress_case(21);
-      decompress_case(22);
-      decompress_case(23);
-      decompress_case(24);
-      decompress_case(25);
-      decompress_case(26);
-      decompress_case(27);
-      decompress_case(28);
-      decompress_case(29);
-      decompress_case(30);
-      decompress_case(31);
-      decompress_case(32);
-      default:
-        fpzip_errno = fpzipErrorBadPrecision;
-        return false;
+  int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * sizeof(T));
+  size_t nx = stream->nx;
+  size_t ny = stream->ny;
+  size_t nz = stream->nz;
+  Coding coding(stream);
+  bool separate = coding.separate();
+  size_t size = nx * ny * nz;
+  bool whole = box.contains(0, 0, 0, nx, ny, nz);
+  // fields are coded back to back and must all be decompressed in order
+  // unless coded using separate lanes, in which case unwanted fields are
+  // skipped; partially wanted fields are decompressed to scratch memory
+  std::vector<T> scratch(whole && (box.f1 - box.f0 == stream->nf || separate) ? 0 : size);
+  for (size_t i = 0; i < stream->nf; i++) {
+    bool wanted = (box.f0 <= i && i < box.f1);
+    // separate lanes end in raw bytes; resume range decoding
+    if (i && separate)
+      stream->rd->init();
+    if (!wanted && separate) {
+      skip3d(stream->rd, coding.streams());
+      continue;
+    }
+    T* p = wanted && whole ? data : &scratch[0];
+    FieldDecoder* field = field_decoder(stream, coding, bits);
+    if (!field->valid()) {
+      fpzip_errno = fpzipErrorBadPrecision;
+      return false;
+    }
+    field->decode(p, nz);
+    field->finish();
+    if (wanted) {
+      if (!whole)
+        copy3d(data, box.nx, box.nx * box.ny, p + box.x0 + nx * (box.y0 + ny * box.z0), nx, nx * ny, box.nx, box.ny, box.nz);
+      data += box.nx * box.ny * box.nz;
+    }
+  }
+  return true;
+}
+
+// decompress box of 4D array stored as independent chunks
+template <typename T>
+static bool
+decompress4d_chunked(
+  FPZinput*  stream, // input stream
+  T*         data,   // flattened 4D array of box samples to decompress to
+  const Box& box     // subarray to decompress
+)
+{
+  int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * sizeof(T));
+  if (!valid_precision<T>(bits)) {
+    fpzip_errno = fpzipErrorBadPrecision;
+    return false;
+  }
+
+  // read table of chunk sizes and convert to offsets
+  const Chunking chunking(stream);
+  if (chunking.count() > INT_MAX) {
+    fpzip_errno = fpzipErrorReadStream;
+    return false;
+  }
+  const int n = (int)chunking.count();
+  RCdecoder* rd = stream->rd;
+  std::vector<size_t> offset(n + 1);
+  offset[0] = 0;
+  for (int i = 0; i < n; i++)
+    offset[i + 1] = offset[i] + rd->decode<uint64>(64);
+
+  const Coding coding(stream);
+
+  // select chunks that overlap the box
+  std::vector<int> chunk;
+  for (int i = 0; i < n; i++) {
+    size_t x, y, z, f, sx, sy, sz;
+    chunking.origin(i, x, y, z, f);
+    chunking.chunk(i, sx, sy, sz);
+    if (box.f0 <= f && f < box.f1 && box.overlaps(x, y, z, sx, sy, sz))
+      chunk.push_back(i);
+  }
+  const int m = (int)chunk.size();
+
+  // fetch selected chunks and skip all others; runs of consecutive chunks
+  // are fetched together, and multiple runs are packed into one buffer
+  std::vector<size_t> start(m);
+  std::vector<uchar> packed;
+  const uchar* buffer = 0;
+  size_t position = 0;
+  for (int j = 0; j < m;) {
+    int k = j;
+    while (++k < m && chunk[k] == chunk[k - 1] + 1);
+    size_t first = offset[chunk[j]];
+    size_t last = offset[chunk[k - 1] + 1];
+    rd->skipbytes(first - position);
+    const uchar* p = rd->getbytes(last - first);
+    position = last;
+    if (j == 0 && k == m)
+      buffer = p;
+    else if (!rd->error)
+      packed.insert(packed.end(), p, p + (last - first));
+    for (; j < k; j++)
+      start[j] = offset[chunk[j]] - first + (buffer ? 0 : packed.size() - (last - first));
+  }
+  rd->skipbytes(offset[n] - position);
+  if (rd->error) {
+    fpzip_errno = fpzipErrorReadStream;
+    return false;
+  }
+  if (!buffer && m)
+    buffer = &packed[0];
+
+  // decompress each chunk that lies entirely within the box directly into
+  // its subarray and all others into scratch memory
+  const size_t dy = box.nx;
+  const size_t dz = dy * box.ny;
+  const size_t df = dz * box.nz;
+  std::vector<int> error(m, fpzipSuccess);
+#ifdef FPZIP_WITH_OPENMP
+  int threads = stream->threads > 0 ? stream->threads : omp_get_max_threads();
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+#endif
+  for (int j = 0; j < m; j++) {
+    try {
+      int i = chunk[j];
+      size_t x, y, z, f, nx, ny, nz;
+      chunking.origin(i, x, y, z, f);
+      chunking.chunk(i, nx, ny, nz);
+      RCmemdecoder cd(buffer + start[j]);
+      cd.init();
+      if (box.contains(x, y, z, nx, ny, nz))
+        decompress3d(&cd, stream->type, data + (f - box.f0) * df + (x - box.x0) + (y - box.y0) * dy + (z - box.z0) * dz, bits, coding, nx, ny, nz, dy, dz);
+      else {
+        std::vector<T> scratch(nx * ny * nz);
+        decompress3d(&cd, stream->type, &scratch[0], bits, coding, nx, ny, nz, nx, nx * ny);
+        // copy intersection of chunk and box
+        size_t x0 = std::max(x, box.x0), x1 = std::min(x + nx, box.x0 + box.nx);
+        size_t y0 = std::max(y, box.y0), y1 = std::min(y + ny, box.y0 + box.ny);
+        size_t z0 = std::max(z, box.z0), z1 = std::min(z + nz, box.z0 + box.nz);
+        copy3d(data + (f - box.f0) * df + (x0 - box.x0) + (y0 - box.y0) * dy + (z0 - box.z0) * dz, dy, dz,
+               &scratch[0] + (x0 - x) + nx * ((y0 - y) + ny * (z0 - z)), nx, nx * ny,
+               x1 - x0, y1 - y0, z1 - z0);
+      }
+      // a valid chunk is consumed in its entirety
+      if (cd.bytes() != offset[i + 1] - offset[i])
+        error[j] = fpzipErrorReadStream;
+    }
+    catch (std::runtime_error&) {
+      // invalid probability model
+      error[j] = fpzipErrorReadStream;
+    }
+    catch (...) {
+      // exceptions cannot propagate out of a parallel region
+      error[j] = fpzipErrorInternal;
     }
-    data += stream->nx * stream->ny * stream->nz;
   }
+
+  for (int j = 0; j < m; j++)
+    if (error[j] != fpzipSuccess) {
+      fpzip_errno = static_cast<fpzipError>(error[j]);
+      return false;
+    }
+
   return true;
 }
 
+// decompress box of a single- or double-precision 4D array
+static size_t
+read4d(
+  FPZinput*  stream, // input stream
+  void*      data,   // array to read
+  const Box& box     // subarray to decompress
+)
+{
+  if (stream->slice != 0 || stream->field) {
+    // array is being decompressed a number of slices at a time
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  size_t bytes = 0;
+  try {
+    RCdecoder* rd = resume(stream);
+    bool chunked = Chunking::enabled(stream);
+    bool success = (stream->type == FPZIP_TYPE_FLOAT
+      ? chunked
+        ? decompress4d_chunked(stream, static_cast<float*>(data), box)
+        : decompress4d(stream, static_cast<float*>(data), box)
+      : chunked
+        ? decompress4d_chunked(stream, static_cast<double*>(data), box)
+        : decompress4d(stream, static_cast<double*>(data), box));
+    // the encoder was finalized; range decoding of any subsequent data
+    // (e.g., another header) starts afresh
+    stream->resume = true;
+    if (success) {
+      if (rd->error) {
+        if (fpzip_errno == fpzipSuccess)
+          fpzip_errno = fpzipErrorReadStream;
+      }
+      else
+        bytes = rd->bytes();
+    }
+  }
+  catch (std::runtime_error&) {
+    // invalid probability model
+    fpzip_errno = fpzipErrorReadStream;
+  }
+  catch (...) {
+    // other exceptions indicate unrecoverable internal errors
+    fpzip_errno = fpzipErrorInternal;
+  }
+  return bytes;
+}
+
 // read compressed stream from file
 FPZ*
 fpzip_read_from_file(
@@ -230,6 +966,68 @@ fpzip_read_from_buffer(
   return static_cast<FPZ*>(stream);
 }
 
+// read compressed stream from memory buffer, recycling a stream closed
+// earlier in the same context
+FPZ*
+fpzip_context_read_from_buffer(
+  fpzip_context* ctx,   // context
+  const void*    buffer // pointer to compressed data
+)
+{
+  fpzip_errno = fpzipSuccess;
+  if (!ctx) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  FPZinput* stream = ctx->input;
+  if (stream) {
+    ctx->input = 0;
+    reset_input(stream);
+    static_cast<RCmemdecoder*>(stream->rd)->open(buffer);
+  }
+  else {
+    stream = allocate_input();
+    stream->rd = new RCmemdecoder(buffer);
+    stream->context = ctx;
+  }
+  stream->rd->init();
+  return static_cast<FPZ*>(stream);
+}
+
+// read compressed stream from file mapped into memory
+FPZ*
+fpzip_read_from_path(
+  const char* path // path of compressed file
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FileMap* map = new FileMap(path);
+  if (!map->valid()) {
+    delete map;
+    fpzip_errno = fpzipErrorReadStream;
+    return 0;
+  }
+  FPZinput* stream = allocate_input();
+  stream->map = map;
+  stream->rd = new RCmapdecoder(map->data(), map->size());
+  stream->rd->init();
+  return static_cast<FPZ*>(stream);
+}
+
+// read compressed stream from memory buffer of known size
+FPZ*
+fpzip_read_from_mmap(
+  const void* buffer, // pointer to compressed data
+  size_t      size    // size of buffer in bytes
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZinput* stream = allocate_input();
+  stream->rd = new RCmapdecoder(buffer, size);
+  stream->rd->init();
+  return static_cast<FPZ*>(stream);
+}
+
 // close stream for reading and clean up
 void
 fpzip_read_close(
@@ -237,21 +1035,33 @@ fpzip_read_close(
 )
 {
   FPZinput* stream = static_cast<FPZinput*>(fpz);
+  // return stream to its context unless the context already holds one
+  fpzip_context* ctx = stream->context;
+  if (ctx && !ctx->input)
+    ctx->input = stream;
+  else
+    fpzip_free_input(stream);
+}
+
+// deallocate input stream and all of its state
+void
+fpzip_free_input(
+  FPZinput* stream // input stream
+)
+{
+  delete stream->cache;
   delete stream->rd;
+  delete stream->map;
+  delete stream->batch;
   delete stream;
 }
 
-// read meta data
-int
-fpzip_read_header(
-  FPZ* fpz // stream handle
+// read magic and format version; return zero if not supported
+static uint
+read_version(
+  RCdecoder* rd // entropy decoder
 )
 {
-  fpzip_errno = fpzipSuccess;
-
-  FPZinput* stream = static_cast<FPZinput*>(fpz);
-  RCdecoder* rd = stream->rd;
-
   // magic
   if (rd->decode<uint>(8) != 'f' ||
       rd->decode<uint>(8) != 'p' ||
@@ -262,21 +1072,110 @@ fpzip_read_header(
   }
 
   // format version
-  if (rd->decode<uint>(16) != FPZ_MAJ_VERSION ||
+  uint version = rd->decode<uint>(16);
+  if ((version != FPZ_MAJ_VERSION && version != FPZ_EXT_VERSION) ||
       rd->decode<uint>(8) != FPZ_MIN_VERSION) {
     fpzip_errno = fpzipErrorBadVersion;
     return 0;
   }
 
+  return version;
+}
+
+// read flags of options of extended header; return zero for the original
+// header and FPZ_OPT_UNKNOWN if any option is not supported
+static uint
+read_options(
+  RCdecoder* rd,     // entropy decoder
+  uint       version // format version
+)
+{
+  if (version != FPZ_EXT_VERSION)
+    return 0;
+  uint options = rd->decode<uint>(16);
+  return options & ~FPZ_OPT_KNOWN ? FPZ_OPT_UNKNOWN : options;
+}
+
+// read values of flagged coding options and set others to their defaults;
+// return false if any value is not supported
+static bool
+read_coding(
+  RCdecoder* rd,     // entropy decoder
+  FPZ*       stream, // stream handle
+  uint       options // flags of options present
+)
+{
+  stream->lanes = options & FPZ_OPT_LANES ? rd->decode<uint>(8) : 0;
+  stream->coder = options & FPZ_OPT_CODER ? rd->decode<uint>(8) : FPZIP_CODER_RANGE;
+  stream->model = options & FPZ_OPT_MODEL ? rd->decode<uint>(8) : FPZIP_MODEL_ADAPTIVE;
+  stream->bypass = options & FPZ_OPT_BYPASS ? 1 : 0;
+  stream->predictor = options & FPZ_OPT_PREDICTOR ? rd->decode<uint>(8) : FPZIP_PREDICTOR_LORENZO;
+  return (stream->coder == FPZIP_CODER_RANGE || stream->coder == FPZIP_CODER_RANS) &&
+         (FPZIP_MODEL_ADAPTIVE <= stream->model && stream->model <= FPZIP_MODEL_CONTEXT) &&
+         (stream->predictor == FPZIP_PREDICTOR_LORENZO || stream->predictor == FPZIP_PREDICTOR_ADAPTIVE);
+}
+
+// read meta data
+int
+fpzip_read_header(
+  FPZ* fpz // stream handle
+)
+{
+  fpzip_errno = fpzipSuccess;
+
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  RCdecoder* rd = resume(stream);
+
+  // discard state of any array decompressed incrementally
+  stream->field = 0;
+  stream->slice = 0;
+  delete stream->batch;
+  stream->batch = 0;
+
+  // magic, format version, and options of extended header
+  uint version = read_version(rd);
+  if (!version)
+    return 0;
+  uint options = read_options(rd, version);
+  if (options & (FPZ_OPT_UNKNOWN | FPZ_OPT_BATCH)) {
+    fpzip_errno = fpzipErrorBadVersion;
+    return 0;
+  }
+
   // type and precision
   stream->type = rd->decode<uint>(1);
   stream->prec = rd->decode<uint>(7);
 
   // array dimensions
-  stream->nx = rd->decode<uint>(32);
-  stream->ny = rd->decode<uint>(32);
-  stream->nz = rd->decode<uint>(32);
-  stream->nf = rd->decode<uint>(32);
+  uint width = options & FPZ_OPT_WIDE ? 64 : 32;
+  uint64 nx = rd->decode<uint64>(width);
+  uint64 ny = rd->decode<uint64>(width);
+  uint64 nz = rd->decode<uint64>(width);
+  uint64 nf = rd->decode<uint64>(width);
+  stream->nx = (size_t)nx;
+  stream->ny = (size_t)ny;
+  stream->nz = (size_t)nz;
+  stream->nf = (size_t)nf;
+  if (stream->nx != nx || stream->ny != ny || stream->nz != nz || stream->nf != nf) {
+    // dimensions not addressable on this platform
+    fpzip_errno = fpzipErrorBadFormat;
+    return 0;
+  }
+
+  // chunk dimensions
+  if (options & FPZ_OPT_CHUNKED) {
+    stream->cx = rd->decode<uint>(32);
+    stream->cy = rd->decode<uint>(32);
+    stream->cz = rd->decode<uint>(32);
+  }
+  else
+    stream->cx = stream->cy = stream->cz = 0;
+
+  // coding options
+  if (!read_coding(rd, stream, options)) {
+    fpzip_errno = fpzipErrorBadVersion;
+    return 0;
+  }
 
   return 1;
 }
@@ -289,25 +1188,371 @@ fpzip_read(
 )
 {
   fpzip_errno = fpzipSuccess;
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  Box box = { 0, 0, 0, 0, stream->nx, stream->ny, stream->nz, stream->nf };
+  return read4d(stream, data, box);
+}
+
+// decompress a single field of a single- or double-precision 4D array
+size_t
+fpzip_read_field(
+  FPZ*  fpz,  // stream handle
+  size_t k,    // index of field to read
+  void*  data  // array to read
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  if (k >= stream->nf) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  Box box = { 0, 0, 0, k, stream->nx, stream->ny, stream->nz, k + 1 };
+  return read4d(stream, data, box);
+}
+
+// decompress a box of a single- or double-precision 4D array
+size_t
+fpzip_read_subvolume(
+  FPZ*   fpz,  // stream handle
+  size_t x0,   // first x sample
+  size_t y0,   // first y sample
+  size_t z0,   // first z sample
+  size_t nx,   // number of x samples
+  size_t ny,   // number of y samples
+  size_t nz,   // number of z samples
+  void*  data  // array to read
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  if (x0 > stream->nx || !nx || nx > stream->nx - x0 ||
+      y0 > stream->ny || !ny || ny > stream->ny - y0 ||
+      z0 > stream->nz || !nz || nz > stream->nz - z0) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  Box box = { x0, y0, z0, 0, nx, ny, nz, stream->nf };
+  return read4d(stream, data, box);
+}
+
+// decompress next nslices z slices of an unchunked array, continuing
+// across fields
+size_t
+fpzip_read_slices(
+  FPZ*  fpz,    // stream handle
+  void* data,   // consecutive slices to read
+  int   nslices // number of slices
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  const size_t nx = stream->nx;
+  const size_t ny = stream->ny;
+  const size_t nz = stream->nz;
+  const uint64 slices = (uint64)nz * stream->nf;
+  if (nslices < 0 || stream->resume || Chunking::enabled(stream) || stream->slice + (uint64)nslices > slices) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  const int type = stream->type;
+  const int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double)));
+  if (!valid_precision(type, bits)) {
+    fpzip_errno = fpzipErrorBadPrecision;
+    return 0;
+  }
   size_t bytes = 0;
   try {
-    FPZinput* stream = static_cast<FPZinput*>(fpz);
-    bool success = (stream->type == FPZIP_TYPE_FLOAT
-      ? decompress4d(stream, static_cast<float*>(data))
-      : decompress4d(stream, static_cast<double*>(data)));
-    if (success) {
-      RCdecoder* rd = stream->rd;
-      if (rd->error) {
-        if (fpzip_errno == fpzipSuccess)
-          fpzip_errno = fpzipErrorReadStream;
+    RCdecoder* rd = stream->rd;
+    const Coding coding(stream);
+    const size_t size = nx * ny * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+    uchar* p = static_cast<uchar*>(data);
+    for (size_t n = nslices; n;) {
+      // decompress as many slices as remain in current field
+      size_t z = (size_t)(stream->slice % nz);
+      size_t m = std::min(n, nz - z);
+      if (!stream->field) {
+        // separate lanes end in raw bytes; resume range decoding
+        if (stream->slice && coding.separate())
+          rd->init();
+        stream->field = field_decoder(stream, coding, bits);
       }
-      else
+      stream->field->decode(p, m);
+      p += m * size;
+      n -= m;
+      stream->slice += m;
+      // finish field once all of its slices have been decompressed
+      if (z + m == nz) {
+        stream->field->finish();
+        stream->field = 0;
+      }
+    }
+    if (stream->slice == slices) {
+      // fields without slices are coded nonetheless
+      if (!nz)
+        for (size_t i = 0; i < stream->nf; i++) {
+          if (i && coding.separate())
+            rd->init();
+          field_decoder(stream, coding, bits)->finish();
+        }
+      // the encoder was finalized; range decoding of any subsequent data
+      // (e.g., another header) starts afresh
+      stream->resume = true;
+    }
+    if (rd->error)
+      fpzip_errno = fpzipErrorReadStream;
+    else
+      bytes = rd->bytes();
+  }
+  catch (std::runtime_error&) {
+    // invalid probability model
+    fpzip_errno = fpzipErrorReadStream;
+  }
+  catch (...) {
+    // other exceptions indicate unrecoverable internal errors
+    fpzip_errno = fpzipErrorInternal;
+  }
+  return bytes;
+}
+
+// decompress segment of batch items from rd, reusing the field decoder and
+// its warm adaptive models for consecutive fields of the same layout
+static void
+decompress_segment(
+  RCdecoder*              rd,     // entropy decoder of segment
+  const Coding&           coding, // entropy coding options
+  fpzip_batch_item*       item,   // arrays of batch
+  const BatchItem*        meta,   // meta data of arrays
+  uint                    first,  // first item of segment
+  uint                    last    // one past last item of segment
+)
+{
+  FieldDecoder* field = 0;
+  try {
+    bool begun = false;
+    for (uint i = first; i < last && !rd->error; i++) {
+      const BatchItem& b = meta[i];
+      const int bits = b.bits();
+      const size_t sy = b.nx;
+      const size_t sz = b.nx * b.ny;
+      uchar* p = static_cast<uchar*>(item[i].data);
+      for (size_t f = 0; f < b.nf && !rd->error; f++) {
+        // separate lanes end in raw bytes; resume range decoding
+        if (begun && coding.separate())
+          rd->init();
+        begun = true;
+        if (field && field->matches(coding, b.type, bits, b.nx, b.ny, sy, sz))
+          field->reset(rd, true);
+        else {
+          delete field;
+          field = 0;
+          field = new FieldDecoder(rd, coding, b.type, bits, b.nx, b.ny, sy, sz);
+        }
+        field->decode(p, b.nz);
+        field->finish();
+        p += b.bytes() / b.nf;
+      }
+    }
+  }
+  catch (...) {
+    delete field;
+    throw;
+  }
+  delete field;
+}
+
+// decode count coded as its number of significant bits followed by the bits
+static size_t
+decode_count(
+  RCdecoder* rd // entropy decoder
+)
+{
+  uint bits = rd->decode<uint>(7);
+  uint64 n = bits ? rd->decode<uint64>(std::min(bits, 64u)) : 0;
+  if ((size_t)n != n)
+    rd->error = true;
+  return (size_t)n;
+}
+
+// read meta data of batch of arrays
+int
+fpzip_read_batch_header(
+  FPZ*              fpz,  // stream handle
+  fpzip_batch_item* item, // arrays whose meta data to set
+  int               n     // number of arrays
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  if (n < 0 || (n && !item)) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return -1;
+  }
+
+  // read header unless read by a previous call
+  if (!stream->batch) {
+    RCdecoder* rd = resume(stream);
+    stream->field = 0;
+    stream->slice = 0;
+
+    // magic, format version, and options of extended header
+    uint version = read_version(rd);
+    if (!version)
+      return -1;
+    uint options = read_options(rd, version);
+    if (options & FPZ_OPT_UNKNOWN) {
+      fpzip_errno = fpzipErrorBadVersion;
+      return -1;
+    }
+    if ((options & (FPZ_OPT_BATCH | FPZ_OPT_WIDE | FPZ_OPT_CHUNKED)) != FPZ_OPT_BATCH) {
+      fpzip_errno = fpzipErrorBadFormat;
+      return -1;
+    }
+
+    // coding options shared by all arrays
+    stream->nx = stream->ny = stream->nz = stream->nf = 0;
+    stream->cx = stream->cy = stream->cz = 0;
+    if (!read_coding(rd, stream, options)) {
+      fpzip_errno = fpzipErrorBadVersion;
+      return -1;
+    }
+
+    // meta data of each array
+    uint count = rd->decode<uint>(32);
+    if (count > INT_MAX) {
+      fpzip_errno = fpzipErrorBadFormat;
+      return -1;
+    }
+    std::vector<BatchItem> meta;
+    for (uint i = 0; i < count && !rd->error; i++) {
+      bool repeated = i && rd->decode();
+      if (repeated)
+        meta.push_back(meta.back());
+      else {
+        BatchItem b;
+        b.type = rd->decode<uint>(1);
+        b.prec = rd->decode<uint>(7);
+        b.nx = decode_count(rd);
+        b.ny = decode_count(rd);
+        b.nz = decode_count(rd);
+        b.nf = decode_count(rd);
+        meta.push_back(b);
+      }
+    }
+    if (rd->error) {
+      fpzip_errno = fpzipErrorReadStream;
+      return -1;
+    }
+    stream->batch = new std::vector<BatchItem>(meta);
+  }
+
+  const std::vector<BatchItem>& meta = *stream->batch;
+  for (int i = 0; i < n && i < (int)meta.size(); i++) {
+    FPZ* b = &item[i].fpz;
+    b->type = meta[i].type;
+    b->prec = meta[i].prec;
+    b->nx = meta[i].nx;
+    b->ny = meta[i].ny;
+    b->nz = meta[i].nz;
+    b->nf = meta[i].nf;
+    b->cx = b->cy = b->cz = 0;
+    b->lanes = stream->lanes;
+    b->coder = stream->coder;
+    b->model = stream->model;
+    b->bypass = stream->bypass;
+    b->predictor = stream->predictor;
+    b->threads = 0;
+  }
+  return (int)meta.size();
+}
+
+// decompress batch of single- or double-precision 4D arrays
+size_t
+fpzip_read_batch(
+  FPZ*              fpz,  // stream handle
+  fpzip_batch_item* item, // arrays to read
+  int               n     // number of arrays
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZinput* stream = static_cast<FPZinput*>(fpz);
+  if (!stream->batch || n != (int)stream->batch->size() || (n && !item)) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  const std::vector<BatchItem>& meta = *stream->batch;
+  for (int i = 0; i < n; i++) {
+    if (!valid_precision(meta[i].type, meta[i].bits())) {
+      fpzip_errno = fpzipErrorBadPrecision;
+      return 0;
+    }
+    if (meta[i].samples() && !item[i].data) {
+      fpzip_errno = fpzipErrorBadArgument;
+      return 0;
+    }
+  }
+
+  size_t bytes = 0;
+  try {
+    // read table of segment sizes and convert to offsets
+    RCdecoder* rd = stream->rd;
+    const Batching batching(meta);
+    const int m = batching.count();
+    std::vector<size_t> offset(m + 1);
+    offset[0] = 0;
+    for (int s = 0; s < m; s++)
+      offset[s + 1] = offset[s] + decode_count(rd);
+
+    // fetch segments
+    const uchar* buffer = rd->getbytes(offset[m]);
+    if (rd->error)
+      fpzip_errno = fpzipErrorReadStream;
+    else {
+      // decompress segments in parallel
+      const Coding coding(stream);
+      std::vector<int> error(m, fpzipSuccess);
+#ifdef FPZIP_WITH_OPENMP
+      int threads = stream->threads > 0 ? stream->threads : omp_get_max_threads();
+      #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+#endif
+      for (int s = 0; s < m; s++) {
+        try {
+          RCmapdecoder cd(buffer + offset[s], offset[s + 1] - offset[s]);
+          cd.init();
+          decompress_segment(&cd, coding, item, &meta[0], batching.first(s), batching.last(s));
+          // a valid segment is consumed in its entirety
+          if (cd.error || cd.bytes() != offset[s + 1] - offset[s])
+            error[s] = fpzipErrorReadStream;
+        }
+        catch (std::runtime_error&) {
+          // invalid probability model
+          error[s] = fpzipErrorReadStream;
+        }
+        catch (...) {
+          // exceptions cannot propagate out of a parallel region
+          error[s] = fpzipErrorInternal;
+        }
+      }
+      for (int s = 0; s < m && fpzip_errno == fpzipSuccess; s++)
+        if (error[s] != fpzipSuccess)
+          fpzip_errno = static_cast<fpzipError>(error[s]);
+      if (fpzip_errno == fpzipSuccess)
         bytes = rd->bytes();
     }
   }
+  catch (std::runtime_error&) {
+    // invalid probability model
+    fpzip_errno = fpzipErrorReadStream;
+  }
   catch (...) {
-    // exceptions indicate unrecoverable internal errors
+    // other exceptions indicate unrecoverable internal errors
     fpzip_errno = fpzipErrorInternal;
   }
+
+  // range decoding of any subsequent data (e.g., another header) starts
+  // afresh
+  delete stream->batch;
+  stream->batch = 0;
+  stream->resume = true;
   return bytes;
 }
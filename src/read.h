@@ -1,65 +1,145 @@
 #ifndef FPZIP_READ_H
 #define FPZIP_READ_H
 
+#include <algorithm>
+#include <vector>
 #include "types.h"
 
 #define subsize(T, n) (CHAR_BIT * sizeof(T) * (n) / 32)
 
 // file reader for compressed data
-#if FPZIP_BLOCK_SIZE > 1
 class RCfiledecoder : public RCdecoder {
 public:
-  RCfiledecoder(FILE* file) : RCdecoder(), file(file), count(0), index(0), size(0) {}
-  uint getbyte()
+  RCfiledecoder(FILE* file) : RCdecoder(), file(file), count(0)
   {
-    if (index == size) {
-      size = fread(buffer, 1, FPZIP_BLOCK_SIZE, file);
-      if (!size) {
-        size = 1;
-        error = true;
+    ptr = end = buffer;
+  }
+  void skipbytes(size_t n)
+  {
+    // consume buffered bytes first, then seek if possible
+    size_t m = std::min(n, (size_t)(end - ptr));
+    ptr += m;
+    n -= m;
+    if (n && fseek(file, n, SEEK_CUR)) {
+      // not seekable
+      while (n && !error) {
+        size_t k = fread(buffer, 1, n < FPZIP_BLOCK_SIZE ? n : FPZIP_BLOCK_SIZE, file);
+        if (!k)
+          error = true;
+        count += k;
+        n -= k;
       }
-      else
-        count += size;
-      index = 0;
+      ptr = end = buffer;
+    }
+    else
+      count += n;
+  }
+  const uchar* getbytes(size_t n)
+  {
+    raw.resize(n);
+    // consume buffered bytes first
+    size_t m = std::min(n, (size_t)(end - ptr));
+    std::copy(ptr, ptr + m, raw.begin());
+    ptr += m;
+    if (m < n) {
+      size_t k = fread(&raw[m], 1, n - m, file);
+      count += k;
+      if (k != n - m)
+        error = true;
     }
-    return buffer[index++];
+    return n ? &raw[0] : 0;
   }
   size_t bytes() const { return count; }
+protected:
+  uint underflow()
+  {
+    size_t size = fread(buffer, 1, FPZIP_BLOCK_SIZE, file);
+    if (!size) {
+      error = true;
+      buffer[0] = 0;
+      size = 1;
+    }
+    else
+      count += size;
+    ptr = buffer + 1;
+    end = buffer + size;
+    return buffer[0];
+  }
 private:
   FILE* file;
   size_t count;
-  size_t index;
-  size_t size;
   uchar buffer[FPZIP_BLOCK_SIZE];
+  std::vector<uchar> raw;
 };
-#else
-class RCfiledecoder : public RCdecoder {
+
+// memory reader for compressed data; the buffer size is not known, so its
+// end is left null and reads are not bounds checked
+class RCmemdecoder : public RCdecoder {
 public:
-  RCfiledecoder(FILE* file) : RCdecoder(), file(file), count(0) {}
-  uint getbyte()
+  RCmemdecoder(const void* buffer) : RCdecoder() { open(buffer); }
+  // start decoding another stream from the given buffer (call init() next)
+  void open(const void* buffer)
   {
-    int byte = fgetc(file);
-    if (byte == EOF)
-      error = true;
-    else
-      count++;
-    return byte;
+    restart();
+    begin = ptr = static_cast<const uchar*>(buffer);
   }
-  size_t bytes() const { return count; }
+  const uchar* getbytes(size_t n)
+  {
+    const uchar* p = ptr;
+    ptr += n;
+    return p;
+  }
+  void skipbytes(size_t n) { ptr += n; }
+  size_t bytes() const { return ptr - begin; }
+protected:
+  uint underflow() { return *ptr++; }
 private:
-  FILE* file;
-  size_t count;
+  const uchar* begin;
 };
-#endif
 
-class RCmemdecoder : public RCdecoder {
+// memory reader for compressed data of known size, e.g., a mapped file;
+// reads past the end of the buffer yield zeros and set the error flag
+class RCmapdecoder : public RCdecoder {
 public:
-  RCmemdecoder(const void* buffer) : RCdecoder(), ptr((const uchar*)buffer), begin(ptr) {}
-  uint getbyte() { return *ptr++; }
+  RCmapdecoder(const void* buffer, size_t size) : RCdecoder(), begin(static_cast<const uchar*>(buffer))
+  {
+    ptr = begin;
+    end = begin + size;
+  }
+  const uchar* getbytes(size_t n)
+  {
+    const uchar* p = ptr;
+    if ((size_t)(end - ptr) < n) {
+      // pad truncated data with zeros
+      error = true;
+      raw.assign(n, 0);
+      std::copy(ptr, end, raw.begin());
+      p = &raw[0];
+      ptr = end;
+    }
+    else
+      ptr += n;
+    return p;
+  }
+  void skipbytes(size_t n)
+  {
+    if ((size_t)(end - ptr) < n) {
+      error = true;
+      ptr = end;
+    }
+    else
+      ptr += n;
+  }
   size_t bytes() const { return ptr - begin; }
+protected:
+  uint underflow()
+  {
+    error = true;
+    return 0;
+  }
 private:
-  const uchar* ptr;
   const uchar* const begin;
+  std::vector<uchar> raw;
 };
 
 #endif
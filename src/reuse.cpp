@@ -0,0 +1,27 @@
+#include "fpzip.h"
+#include "reuse.h"
+
+// allocate context with no streams to recycle
+fpzip_context*
+fpzip_context_create()
+{
+  fpzip_context* ctx = new fpzip_context;
+  ctx->output = 0;
+  ctx->input = 0;
+  return ctx;
+}
+
+// deallocate context and the streams it keeps
+void
+fpzip_context_free(
+  fpzip_context* ctx // context
+)
+{
+  if (!ctx)
+    return;
+  if (ctx->output)
+    fpzip_free_output(ctx->output);
+  if (ctx->input)
+    fpzip_free_input(ctx->input);
+  delete ctx;
+}
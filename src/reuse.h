@@ -0,0 +1,24 @@
+#ifndef FPZIP_REUSE_H
+#define FPZIP_REUSE_H
+
+#include "fpzip.h"
+
+struct FPZinput;
+struct FPZoutput;
+
+// Closed streams kept for reuse.  Each stream retains its memory coder
+// and the (de)coder of its most recent field, whose prediction buffers,
+// lanes, and probability models are reset in place when the next array
+// has the same layout and coding options.
+struct fpzip_context {
+  FPZoutput* output; // output stream to recycle, if any
+  FPZinput*  input;  // input stream to recycle, if any
+};
+
+// deallocate output stream and all of its state
+void fpzip_free_output(FPZoutput* stream);
+
+// deallocate input stream and all of its state
+void fpzip_free_input(FPZinput* stream);
+
+#endif
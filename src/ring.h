@@ -0,0 +1,115 @@
+#ifndef FPZIP_RING_H
+#define FPZIP_RING_H
+
+#include <cstddef>
+#include <vector>
+#include "types.h"
+#if defined __unix__ || (defined __APPLE__ && defined __MACH__)
+  #include <sched.h>
+  #define FPZIP_YIELD() sched_yield()
+#elif defined _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+  #define FPZIP_YIELD() SwitchToThread()
+#else
+  #define FPZIP_YIELD()
+#endif
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+  #define FPZIP_PAUSE() __builtin_ia32_pause()
+#else
+  #define FPZIP_PAUSE()
+#endif
+
+// Lock-free queue of fixed-size blocks of items passed from one producer
+// thread to one consumer thread.  The block counters are accessed via
+// OpenMP atomics, with flushes ordering accesses to the items themselves.
+// Waiting threads spin briefly and then yield the processor, so that a
+// thread without a core of its own does not starve the other one.
+template <typename T>
+class Ring {
+public:
+  Ring(uint blocks, size_t size) :
+    blocks(blocks), size(size), head(0), tail(0), count(blocks), item(blocks * size)
+  {}
+
+  // maximum number of items per block
+  size_t block_size() const { return size; }
+
+  // producer: wait for and return an empty block
+  T* acquire()
+  {
+    for (Backoff b; head - load(tail) == blocks; b.wait());
+    #pragma omp flush
+    return &item[(head % blocks) * size];
+  }
+
+  // producer: pass the n items of the last acquired block to the consumer
+  void publish(size_t n)
+  {
+    count[head % blocks] = n;
+    #pragma omp flush
+    store(head, head + 1);
+  }
+
+  // consumer: wait for and return a block of n items
+  const T* fetch(size_t& n)
+  {
+    for (Backoff b; load(head) == tail; b.wait());
+    #pragma omp flush
+    n = count[tail % blocks];
+    return &item[(tail % blocks) * size];
+  }
+
+  // consumer: return the last fetched block to the producer
+  void release()
+  {
+    #pragma omp flush
+    store(tail, tail + 1);
+  }
+
+private:
+  // waits by spinning for a while, then by yielding the processor
+  class Backoff {
+  public:
+    Backoff() : spins(0) {}
+    void wait()
+    {
+      if (spins < 0x40) {
+        spins++;
+        FPZIP_PAUSE();
+      }
+      else
+        FPZIP_YIELD();
+    }
+  private:
+    uint spins; // number of spins so far
+  };
+
+  static uint load(const uint& x)
+  {
+    uint v;
+    #pragma omp atomic read
+    v = x;
+    return v;
+  }
+
+  static void store(uint& x, uint v)
+  {
+    #pragma omp atomic write
+    x = v;
+  }
+
+  const uint          blocks; // number of blocks
+  const size_t        size;   // items per block
+  uint                head;   // number of blocks published
+  uint                tail;   // number of blocks released
+  std::vector<size_t> count;  // number of items in each block
+  std::vector<T>      item;   // storage for all blocks
+};
+
+#endif
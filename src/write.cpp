@@ -1,156 +1,1105 @@
+#include <algorithm>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
+#ifdef FPZIP_WITH_OPENMP
+#include <omp.h>
+#endif
 #include "pcencoder.h"
+#include "ansencoder.h"
+#include "rawencoder.h"
 #include "rcqsmodel.h"
-#include "front.h"
+#include "rcstaticmodel.h"
 #include "fpzip.h"
 #include "codec.h"
+#include "batch.h"
+#include "chunk.h"
+#include "coding.h"
+#include "context.h"
+#include "cpu.h"
+#include "reuse.h"
 #include "write.h"
+#ifdef FPZIP_WITH_OPENMP
+#include "ring.h"
+#endif
+
+class FieldEncoder;
 
 // array meta data and encoder
 struct FPZoutput : public FPZ {
-  RCencoder* re;
+  RCencoder*     re;
+  fpzipError     failure; // error reported when re cannot be written
+  bool           begun;   // has incremental compression begun?
+  uint64         slice;   // number of slices compressed incrementally
+  FieldEncoder*  field;   // cache while a field is partially compressed, else null
+  FieldEncoder*  cache;   // encoder of most recent field, kept for reuse
+  fpzip_context* context; // context that recycles stream, if any
 };
 
+// set meta data and state of output stream to their defaults
+static void
+reset_output(
+  FPZoutput* stream // output stream
+)
+{
+  stream->type = FPZIP_TYPE_FLOAT;
+  stream->prec = 0;
+  stream->nx = stream->ny = stream->nz = stream->nf = 1;
+  stream->cx = stream->cy = stream->cz = 0;
+  stream->lanes = 0;
+  stream->coder = FPZIP_CODER_RANGE;
+  stream->model = FPZIP_MODEL_ADAPTIVE;
+  stream->bypass = 0;
+  stream->predictor = FPZIP_PREDICTOR_LORENZO;
+  stream->threads = 0;
+  stream->failure = fpzipErrorWriteStream;
+  stream->begun = false;
+  stream->slice = 0;
+  stream->field = 0;
+}
+
 // allocate output stream
 static FPZoutput*
 allocate_output()
 {
   FPZoutput* stream = new FPZoutput;
-  stream->type = FPZIP_TYPE_FLOAT;
-  stream->prec = 0;
-  stream->nx = stream->ny = stream->nz = stream->nf = 1;
+  reset_output(stream);
   stream->re = 0;
+  stream->cache = 0;
+  stream->context = 0;
   return stream;
 }
 
+// The Lorenzo prediction of each sample depends only on its reconstructed
+// neighbors, which are known to the encoder before coding begins.  Hence
+// samples are predicted and mapped to integers a whole row at a time, in
+// loops amenable to vectorization, with only the entropy coding of the
+// mapped values and predictions done one sample at a time.  Each row kernel
+// below operates on rows padded with one leading sample, i.e., x[-1] is
+// valid and holds the zero value for the first sample in a row.  Rows are
+// stored back to back, so x[-2] is the last sample of the preceding row (or
+// zero for the first row in a plane), as in the decoder's front.
+
 #if FPZIP_FP == FPZIP_FP_FAST || FPZIP_FP == FPZIP_FP_SAFE
-// compress 3D array at specified precision using floating-point arithmetic
+// row kernels using floating-point arithmetic
 template <typename T, uint bits>
-static void
-compress3d(
-  RCencoder* re,   // entropy encoder
-  const T*   data, // flattened 3D array to compress
-  uint       nx,   // number of x samples
-  uint       ny,   // number of y samples
-  uint       nz    // number of z samples
-)
-{
-  // initialize compressor
-  typedef PCmap<T, bits> Map;
-  RCmodel* rm = new RCqsmodel(true, PCencoder<T, Map>::symbols);
-  PCencoder<T, Map>* fe = new PCencoder<T, Map>(re, &rm);
-  Front<T> f(nx, ny);
-
-  // encode difference between predicted (p) and actual (a) value
-  uint x, y, z;
-  for (z = 0, f.advance(0, 0, 1); z < nz; z++)
-    for (y = 0, f.advance(0, 1, 0); y < ny; y++)
-      for (x = 0, f.advance(1, 0, 0); x < nx; x++) {
-        #if FPZIP_FP == FPZIP_FP_SAFE
-        volatile T p = f(1, 1, 1);
-        p += f(1, 0, 0);
-        p -= f(0, 1, 1);
-        p += f(0, 1, 0);
-        p -= f(1, 0, 1);
-        p += f(0, 0, 1);
-        p -= f(1, 1, 0);
-        #else
-        T p = f(1, 0, 0) - f(0, 1, 1) +
-              f(0, 1, 0) - f(1, 0, 1) +
-              f(0, 0, 1) - f(1, 1, 0) +
-              f(1, 1, 1);
-        #endif
-        T a = *data++;
-        a = fe->encode(a, p);
-        f.push(a);
-      }
+struct PCrow {
+  typedef PCmap<T, bits> Map; // map used by entropy coder
+  typedef T Value;            // type of reconstructed samples
 
-  delete fe;
-  delete rm;
-}
+  static Value zero() { return 0; }
+
+  // map samples to integers r and store reconstructed samples in c
+  static void map(typename Map::Range* r, Value* c, const T* data, size_t n)
+  {
+    Map map;
+    for (size_t x = 0; x < n; x++) {
+      r[x] = map.forward(data[x]);
+      c[x] = map.identity(data[x]);
+    }
+  }
+
+  // predict current row c from rows b (below), pc (previous plane), and
+  // pb (below in previous plane) and map predictions to integers p
+  static void predict(typename Map::Range* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n)
+  {
+    Map map;
+    const Value* cw = c - 1;
+    const Value* bw = b - 1;
+    const Value* pcw = pc - 1;
+    const Value* pbw = pb - 1;
+    for (size_t x = 0; x < n; x++) {
+      #if FPZIP_FP == FPZIP_FP_SAFE
+      volatile T s = pbw[x];
+      s += cw[x];
+      s -= pb[x];
+      s += b[x];
+      s -= pcw[x];
+      s += pc[x];
+      s -= bw[x];
+      p[x] = map.forward(s);
+      #else
+      T s = cw[x] - pb[x] +
+            b[x] - pcw[x] +
+            pc[x] - bw[x] +
+            pbw[x];
+      p[x] = map.forward(s);
+      #endif
+    }
+  }
+
+  // predict current row c from row b (below) using a lower-dimensional
+  // predictor of given kind and map predictions to integers p
+  static void predict(typename Map::Range* p, const Value* c, const Value* b, uint kind, size_t n)
+  {
+    Map map;
+    const Value* cw = c - 1;
+    const Value* cww = c - 2;
+    const Value* bw = b - 1;
+    switch (kind) {
+      case FPZ_PRED_PLANE:
+        for (size_t x = 0; x < n; x++) {
+          #if FPZIP_FP == FPZIP_FP_SAFE
+          volatile T s = cw[x];
+          s -= bw[x];
+          s += b[x];
+          p[x] = map.forward(s);
+          #else
+          T s = cw[x] - bw[x] + b[x];
+          p[x] = map.forward(s);
+          #endif
+        }
+        break;
+      case FPZ_PRED_PREV:
+        for (size_t x = 0; x < n; x++)
+          p[x] = map.forward(cw[x]);
+        break;
+      default:
+        for (size_t x = 0; x < n; x++) {
+          #if FPZIP_FP == FPZIP_FP_SAFE
+          volatile T s = cw[x];
+          s += cw[x];
+          s -= cww[x];
+          p[x] = map.forward(s);
+          #else
+          T s = cw[x] + cw[x] - cww[x];
+          p[x] = map.forward(s);
+          #endif
+        }
+        break;
+    }
+  }
+};
 #elif FPZIP_FP == FPZIP_FP_EMUL
 #include "fpe.h"
-// compress 3D array at specified precision using floating-point emulation
+// row kernels using floating-point emulation
 template <typename T, uint bits>
-static void
-compress3d(
-  RCencoder* re,   // entropy encoder
-  const T*   data, // flattened 3D array to compress
-  uint       nx,   // number of x samples
-  uint       ny,   // number of y samples
-  uint       nz    // number of z samples
-)
-{
-  // initialize compressor
-  typedef PCmap<T, bits> Map;
-  typedef FPE<T> Float;
-  RCmodel* rm = new RCqsmodel(true, PCencoder<T, Map>::symbols);
-  PCencoder<T, Map>* fe = new PCencoder<T, Map>(re, &rm);
-  Front<Float> f(nx, ny);
-
-  // encode difference between predicted (p) and actual (a) value
-  uint x, y, z;
-  for (z = 0, f.advance(0, 0, 1); z < nz; z++)
-    for (y = 0, f.advance(0, 1, 0); y < ny; y++)
-      for (x = 0, f.advance(1, 0, 0); x < nx; x++) {
-        Float p = f(1, 0, 0) - f(0, 1, 1) +
-                  f(0, 1, 0) - f(1, 0, 1) +
-                  f(0, 0, 1) - f(1, 1, 0) +
-                  f(1, 1, 1);
-        T a = *data++;
-        a = fe->encode(a, T(p));
-        f.push(a);
-      }
+struct PCrow {
+  typedef PCmap<T, bits> Map; // map used by entropy coder
+  typedef FPE<T> Value;       // type of reconstructed samples
 
-  delete fe;
-  delete rm;
-}
+  static Value zero() { return 0; }
+
+  // map samples to integers r and store reconstructed samples in c
+  static void map(typename Map::Range* r, Value* c, const T* data, size_t n)
+  {
+    Map map;
+    for (size_t x = 0; x < n; x++) {
+      r[x] = map.forward(data[x]);
+      c[x] = map.identity(data[x]);
+    }
+  }
+
+  // predict current row c from rows b (below), pc (previous plane), and
+  // pb (below in previous plane) and map predictions to integers p
+  static void predict(typename Map::Range* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n)
+  {
+    Map map;
+    const Value* cw = c - 1;
+    const Value* bw = b - 1;
+    const Value* pcw = pc - 1;
+    const Value* pbw = pb - 1;
+    for (size_t x = 0; x < n; x++) {
+      Value s = cw[x] - pb[x] +
+                b[x] - pcw[x] +
+                pc[x] - bw[x] +
+                pbw[x];
+      p[x] = map.forward(T(s));
+    }
+  }
+
+  // predict current row c from row b (below) using a lower-dimensional
+  // predictor of given kind and map predictions to integers p
+  static void predict(typename Map::Range* p, const Value* c, const Value* b, uint kind, size_t n)
+  {
+    Map map;
+    const Value* cw = c - 1;
+    const Value* cww = c - 2;
+    const Value* bw = b - 1;
+    for (size_t x = 0; x < n; x++) {
+      Value s = kind == FPZ_PRED_PLANE ? cw[x] - bw[x] + b[x] :
+                kind == FPZ_PRED_PREV  ? cw[x] :
+                                         cw[x] + cw[x] - cww[x];
+      p[x] = map.forward(T(s));
+    }
+  }
+};
 #else // FPZIP_FP_INT
-// compress 3D array at specified precision using integer arithmetic
+// row kernels using integer arithmetic
 template <typename T, uint bits>
-static void
-compress3d(
-  RCencoder* re,   // entropy encoder
-  const T*   data, // flattened 3D array to compress
-  uint       nx,   // number of x samples
-  uint       ny,   // number of y samples
-  uint       nz    // number of z samples
-)
-{
-  // initialize compressor
+struct PCrow {
   typedef PCmap<T, bits> TMap;
   typedef typename TMap::Range U;
-  typedef PCmap<U, bits, U> UMap;
-  RCmodel* rm = new RCqsmodel(true, PCencoder<U, UMap>::symbols);
-  PCencoder<U, UMap>* fe = new PCencoder<U, UMap>(re, &rm);
-  TMap map;
-  Front<U> f(nx, ny, map.forward(0));
-
-  // encode difference between predicted (p) and actual (a) value
-  uint x, y, z;
-  for (z = 0, f.advance(0, 0, 1); z < nz; z++)
-    for (y = 0, f.advance(0, 1, 0); y < ny; y++)
-      for (x = 0, f.advance(1, 0, 0); x < nx; x++) {
-        U p = f(1, 0, 0) - f(0, 1, 1) +
-              f(0, 1, 0) - f(1, 0, 1) +
-              f(0, 0, 1) - f(1, 1, 0) +
-              f(1, 1, 1);
-        U a = map.forward(*data++);
-        a = fe->encode(a, p);
-        f.push(a);
+  typedef PCmap<U, bits, U> Map; // map used by entropy coder
+  typedef U Value;               // type of reconstructed samples
+
+  static Value zero() { return TMap().forward(0); }
+
+  // map samples to integers r and store reconstructed samples in c
+  static void map(U* r, Value* c, const T* data, size_t n)
+  {
+    TMap tmap;
+    Map map;
+    for (size_t x = 0; x < n; x++) {
+      U a = tmap.forward(data[x]);
+      r[x] = map.forward(a);
+      c[x] = map.identity(a);
+    }
+  }
+
+  // predict current row c from rows b (below), pc (previous plane), and
+  // pb (below in previous plane) and map predictions to integers p
+  static void predict(U* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n)
+  {
+    Map map;
+    const Value* cw = c - 1;
+    const Value* bw = b - 1;
+    const Value* pcw = pc - 1;
+    const Value* pbw = pb - 1;
+    for (size_t x = 0; x < n; x++) {
+      U s = cw[x] - pb[x] +
+            b[x] - pcw[x] +
+            pc[x] - bw[x] +
+            pbw[x];
+      p[x] = map.forward(s);
+    }
+  }
+
+  // predict current row c from row b (below) using a lower-dimensional
+  // predictor of given kind and map predictions to integers p
+  static void predict(U* p, const Value* c, const Value* b, uint kind, size_t n)
+  {
+    Map map;
+    const Value* cw = c - 1;
+    const Value* cww = c - 2;
+    const Value* bw = b - 1;
+    switch (kind) {
+      case FPZ_PRED_PLANE:
+        for (size_t x = 0; x < n; x++)
+          p[x] = map.forward(cw[x] - bw[x] + b[x]);
+        break;
+      case FPZ_PRED_PREV:
+        for (size_t x = 0; x < n; x++)
+          p[x] = map.forward(cw[x]);
+        break;
+      default:
+        for (size_t x = 0; x < n; x++)
+          p[x] = map.forward(cw[x] + cw[x] - cww[x]);
+        break;
+    }
+  }
+};
+#endif
+
+#if FPZIP_DISPATCH
+// row kernels compiled for several instruction set extensions, with the most
+// capable one supported by the processor selected at run time; each variant
+// vectorizes the same scalar code and thus produces identical results
+template <typename T, uint bits>
+struct PCdispatch {
+  typedef PCrow<T, bits> Row;
+  typedef typename Row::Map::Range U;
+  typedef typename Row::Value Value;
+
+  static void map(U* r, Value* c, const T* data, size_t n)
+  {
+    switch (fpzip_cpu()) {
+      case FPZIP_CPU_AVX512: map_avx512(r, c, data, n); break;
+      case FPZIP_CPU_AVX2:   map_avx2(r, c, data, n); break;
+      case FPZIP_CPU_SSE42:  map_sse42(r, c, data, n); break;
+      default:               Row::map(r, c, data, n); break;
+    }
+  }
+
+  static void predict(U* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n)
+  {
+    switch (fpzip_cpu()) {
+      case FPZIP_CPU_AVX512: predict_avx512(p, c, b, pc, pb, n); break;
+      case FPZIP_CPU_AVX2:   predict_avx2(p, c, b, pc, pb, n); break;
+      case FPZIP_CPU_SSE42:  predict_sse42(p, c, b, pc, pb, n); break;
+      default:               Row::predict(p, c, b, pc, pb, n); break;
+    }
+  }
+
+  static void predict(U* p, const Value* c, const Value* b, uint kind, size_t n)
+  {
+    switch (fpzip_cpu()) {
+      case FPZIP_CPU_AVX512: predict_avx512(p, c, b, kind, n); break;
+      case FPZIP_CPU_AVX2:   predict_avx2(p, c, b, kind, n); break;
+      case FPZIP_CPU_SSE42:  predict_sse42(p, c, b, kind, n); break;
+      default:               Row::predict(p, c, b, kind, n); break;
+    }
+  }
+
+private:
+  FPZIP_TARGET("avx512f,avx512vl,avx512bw,avx512dq")
+  static void map_avx512(U* r, Value* c, const T* data, size_t n) { Row::map(r, c, data, n); }
+  FPZIP_TARGET("avx2")
+  static void map_avx2(U* r, Value* c, const T* data, size_t n) { Row::map(r, c, data, n); }
+  FPZIP_TARGET("sse4.2")
+  static void map_sse42(U* r, Value* c, const T* data, size_t n) { Row::map(r, c, data, n); }
+
+  FPZIP_TARGET("avx512f,avx512vl,avx512bw,avx512dq")
+  static void predict_avx512(U* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n) { Row::predict(p, c, b, pc, pb, n); }
+  FPZIP_TARGET("avx2")
+  static void predict_avx2(U* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n) { Row::predict(p, c, b, pc, pb, n); }
+  FPZIP_TARGET("sse4.2")
+  static void predict_sse42(U* p, const Value* c, const Value* b, const Value* pc, const Value* pb, size_t n) { Row::predict(p, c, b, pc, pb, n); }
+
+  FPZIP_TARGET("avx512f,avx512vl,avx512bw,avx512dq")
+  static void predict_avx512(U* p, const Value* c, const Value* b, uint kind, size_t n) { Row::predict(p, c, b, kind, n); }
+  FPZIP_TARGET("avx2")
+  static void predict_avx2(U* p, const Value* c, const Value* b, uint kind, size_t n) { Row::predict(p, c, b, kind, n); }
+  FPZIP_TARGET("sse4.2")
+  static void predict_sse42(U* p, const Value* c, const Value* b, uint kind, size_t n) { Row::predict(p, c, b, kind, n); }
+};
+#else
+// row kernels compiled for the baseline instruction set only
+template <typename T, uint bits>
+struct PCdispatch : PCrow<T, bits> {};
+#endif
+
+// distance between samples on which row predictors are scored
+#define FPZ_PRED_STRIDE 16
+
+// predicts and maps a 3D array to integers one row at a time; adaptive
+// prediction selects for each row the predictor whose residuals have the
+// fewest significant bits on a subset of its samples
+template <typename T, uint bits>
+class Predictor {
+public:
+  typedef PCrow<T, bits> Row;
+  typedef PCdispatch<T, bits> Kernel;
+  typedef typename Row::Map Map;
+  typedef typename Map::Range U;
+  typedef typename Row::Value V;
+
+  Predictor(const T* data, size_t nx, size_t ny, size_t nz, size_t sy, size_t sz, bool adaptive = false) :
+    data(data), nx(nx), ny(ny), nz(nz), sy(sy), sz(sz), mx(nx + 1), mxy(mx * (ny + 1)),
+    y(ny), z(0), first(true), adaptive(adaptive), recording(false), selected(FPZ_PRED_LORENZO), row(0), plane(2 * mxy, Row::zero()),
+    r(nx), p(nx)
+  {}
+
+  // start over with a new array of the same dimensions
+  void reset()
+  {
+    data = 0;
+    nz = 0;
+    y = ny;
+    z = 0;
+    first = true;
+    recording = false;
+    row = 0;
+    trace.clear();
+    std::fill(plane.begin(), plane.end(), Row::zero());
+  }
+
+  // continue with nz more planes starting at data once all rows of the
+  // current planes have been visited
+  void append(const T* data, size_t nz)
+  {
+    this->data = data;
+    this->nz += nz;
+    first = true;
+  }
+
+  // advance to next row; return false if there is none
+  bool next()
+  {
+    if (!nx || !ny)
+      return false;
+    if (y == ny) {
+      // advance to next plane
+      if (z == nz)
+        return false;
+      if (!first)
+        data += sz - ny * sy;
+      first = false;
+      z++;
+      y = 0;
+    }
+    // reconstructed samples of current and previous plane are padded with
+    // one leading row and one leading sample per row
+    V* c = &plane[(z & 1u) * mxy + mx * (y + 1) + 1];
+    V* pc = &plane[(~z & 1u) * mxy + mx * (y + 1) + 1];
+    Kernel::map(&r[0], c, data, nx);
+    if (adaptive) {
+      if (recording || row == trace.size()) {
+        selected = select(c, c - mx, pc, pc - mx);
+        if (recording)
+          trace.push_back((uchar)selected);
+      }
+      else
+        selected = trace[row++];
+    }
+    if (selected == FPZ_PRED_LORENZO)
+      Kernel::predict(&p[0], c, c - mx, pc, pc - mx, nx);
+    else
+      Kernel::predict(&p[0], c, c - mx, selected, nx);
+    data += sy;
+    y++;
+    return true;
+  }
+
+  // mapped values (r) and predictions (p) of current row of nx samples
+  const U* real() const { return &r[0]; }
+  const U* pred() const { return &p[0]; }
+
+  // predictor used for current row
+  uint kind() const { return selected; }
+
+  // record predictors selected for subsequent rows
+  void record() { recording = true; }
+
+  // predictors recorded so far
+  std::vector<uchar>& recorded() { return trace; }
+
+  // use predictors recorded in another pass over the same rows instead of
+  // selecting them again
+  void replay(std::vector<uchar>& kinds)
+  {
+    trace.swap(kinds);
+    row = 0;
+  }
+
+private:
+  // select best predictor for row c given row b below and rows pc and pb
+  // of previous plane by scoring candidates on a sample of the row
+  uint select(const V* c, const V* b, const V* pc, const V* pb) const
+  {
+    uint64 best = 0;
+    for (size_t x = 0; x < nx; x += FPZ_PRED_STRIDE) {
+      U s;
+      Row::predict(&s, c + x, b + x, pc + x, pb + x, 1);
+      best += cost(r[x], s);
+    }
+    uint kind = FPZ_PRED_LORENZO;
+    for (uint k = FPZ_PRED_PLANE; k <= FPZ_PRED_LINEAR && best; k++) {
+      uint64 e = 0;
+      for (size_t x = 0; x < nx && e < best; x += FPZ_PRED_STRIDE) {
+        U s;
+        Row::predict(&s, c + x, b + x, k, 1);
+        e += cost(r[x], s);
+      }
+      if (e < best) {
+        best = e;
+        kind = k;
+      }
+    }
+    return kind;
+  }
+
+  // estimate cost of coding mapped value r given prediction s as the number
+  // of significant bits of the residual
+  static uint cost(U r, U s)
+  {
+    U d = r > s ? r - s : s - r;
+    return d ? 1 + PC::bsr(d) : 0;
+  }
+
+  const T*           data;      // next row to predict
+  const size_t       nx;        // number of x samples
+  const size_t       ny;        // number of y samples
+  size_t             nz;        // number of z samples
+  const size_t       sy;        // distance between consecutive rows
+  const size_t       sz;        // distance between consecutive planes
+  const size_t       mx;        // padded row size
+  const size_t       mxy;       // padded plane size
+  size_t             y;         // index of next row within plane
+  size_t             z;         // one plus index of current plane
+  bool               first;     // is next plane the first one appended?
+  const bool         adaptive;  // is the predictor selected per row?
+  bool               recording; // are selected predictors recorded?
+  uint               selected;  // predictor of current row
+  size_t             row;       // index of next row to replay
+  std::vector<uchar> trace;     // recorded or replayed predictors of rows
+  std::vector<V>     plane;     // reconstructed samples of two consecutive planes
+  std::vector<U>     r;         // mapped values of current row
+  std::vector<U>     p;         // mapped predictions of current row
+};
+
+// residual encoders for samples distributed round-robin over lanes
+template <typename T, class M, class E>
+class LaneEncoder {
+public:
+  typedef PCencoder<T, M, E> Encoder;
+  typedef typename M::Range U;
+  typedef typename Encoder::Residual Residual;
+
+  // use models of given kind; semi-static models are built from symbol
+  // counts for each lane and have their frequency tables written to the
+  // lanes, while context-selected models track the activity of rows of nx
+  // samples in planes of ny rows
+  LaneEncoder(E*const* re, uint n, uint model, const uint64* count, size_t nx, size_t ny) :
+    re(re), n(n), i(0), model(model),
+    cx(model == FPZIP_MODEL_CONTEXT ? new Context(Encoder::symbols, M::bits > PC_BIT_MAX, nx, ny) : 0),
+    rm(n * (cx ? Context::count : 1)), fe(n)
+  {
+    uint contexts = cx ? Context::count : 1;
+    for (uint k = 0; k < n; k++) {
+      for (uint c = 0; c < contexts; c++) {
+        RCmodel*& m = rm[k * contexts + c];
+        if (model == FPZIP_MODEL_STATIC) {
+          RCstaticmodel* sm = new RCstaticmodel(true, Encoder::symbols);
+          sm->build(count + k * Encoder::symbols);
+          sm->write(re[k]);
+          m = sm;
+        }
+        else
+          m = new RCqsmodel(true, Encoder::symbols);
+      }
+      fe[k] = new Encoder(re[k], &rm[k * contexts]);
+    }
+  }
+
+  ~LaneEncoder()
+  {
+    for (uint k = 0; k < n; k++)
+      delete fe[k];
+    for (uint k = 0; k < rm.size(); k++)
+      delete rm[k];
+    delete cx;
+  }
+
+  // reinitialize models in place for encoding another array; semi-static
+  // models are rebuilt from new symbol counts and written to the lanes, and
+  // adaptive models keep their statistics when warm
+  void reset(const uint64* count, bool warm)
+  {
+    i = 0;
+    if (cx)
+      cx->reset();
+    uint contexts = cx ? Context::count : 1;
+    for (uint k = 0; k < n; k++)
+      for (uint c = 0; c < contexts; c++) {
+        RCmodel* m = rm[k * contexts + c];
+        if (model == FPZIP_MODEL_STATIC) {
+          RCstaticmodel* sm = static_cast<RCstaticmodel*>(m);
+          sm->build(count + k * Encoder::symbols);
+          sm->write(re[k]);
+        }
+        else if (warm)
+          continue;
+        else
+          static_cast<RCqsmodel*>(m)->reset();
+      }
+  }
+
+  // encode next row of m mapped values r with mapped predictions p; the
+  // models are called through their concrete type so that the per-sample
+  // coding path is compiled without virtual calls
+  void encode(const U* r, const U* p, size_t m)
+  {
+    switch (model) {
+      case FPZIP_MODEL_STATIC:
+        encode_mapped<RCstaticmodel>(r, p, m);
+        break;
+      default:
+        encode_mapped<RCqsmodel>(r, p, m);
+        break;
+    }
+  }
+
+  // encode m residuals d, which must not be context modeled
+  void encode(const Residual* d, size_t m)
+  {
+    switch (model) {
+      case FPZIP_MODEL_STATIC:
+        encode_residual<RCstaticmodel>(d, m);
+        break;
+      default:
+        encode_residual<RCqsmodel>(d, m);
+        break;
+    }
+  }
+
+  // compute residual of mapped value r with respect to mapped prediction p
+  static Residual residual(U r, U p) { return Encoder::residual(r, p); }
+
+private:
+  // encode row using models of type R
+  template <class R>
+  void encode_mapped(const U* r, const U* p, size_t m)
+  {
+    if (cx) {
+      cx->advance();
+      for (size_t x = 0; x < m; x++) {
+        Residual d = Encoder::residual(r[x], p[x]);
+        uint c = (*cx)(x);
+        cx->update(x, Encoder::symbol(d));
+        fe[i]->template encode_residual<R>(d, c);
+        if (++i == n)
+          i = 0;
       }
+    }
+    else {
+      for (size_t x = 0; x < m; x++) {
+        fe[i]->template encode_mapped<R>(r[x], p[x]);
+        if (++i == n)
+          i = 0;
+      }
+    }
+  }
 
-  delete fe;
-  delete rm;
+  // encode residuals using models of type R
+  template <class R>
+  void encode_residual(const Residual* d, size_t m)
+  {
+    for (size_t j = 0; j < m; j++) {
+      fe[i]->template encode_residual<R>(d[j]);
+      if (++i == n)
+        i = 0;
+    }
+  }
+
+  E*const*const          re;    // entropy encoder for each lane
+  const uint             n;     // number of lanes
+  uint                   i;     // index of next lane
+  const uint             model; // kind of probability model
+  Context*const          cx;    // model selector, if any
+  std::vector<RCmodel*>  rm;    // probability models for each lane and context
+  std::vector<Encoder*>  fe;    // residual encoder for each lane
+};
+
+// count symbols coded in each lane in a first pass over a 3D array
+template <typename T, uint bits, class E>
+static std::vector<uint64>
+histogram(
+  const Coding&       coding, // coding options
+  const T*            data,   // flattened 3D array to compress
+  size_t              nx,     // number of x samples
+  size_t              ny,     // number of y samples
+  size_t              nz,     // number of z samples
+  size_t              sy,     // distance between consecutive rows
+  size_t              sz,     // distance between consecutive planes
+  std::vector<uchar>& kinds   // output predictors selected for rows
+)
+{
+  typedef typename PCrow<T, bits>::Map Map;
+  typedef typename Map::Domain D;
+  typedef typename LaneEncoder<D, Map, E>::Encoder Encoder;
+  const uint lanes = coding.lanes;
+  std::vector<uint64> count(lanes * Encoder::symbols, 0);
+  Predictor<T, bits> rows(data, nx, ny, nz, sy, sz, coding.adaptive);
+  rows.record();
+  uint i = 0;
+  while (rows.next()) {
+    const typename Map::Range* r = rows.real();
+    const typename Map::Range* p = rows.pred();
+    for (size_t x = 0; x < nx; x++) {
+      count[i * Encoder::symbols + Encoder::symbol(Encoder::residual(r[x], p[x]))]++;
+      if (++i == lanes)
+        i = 0;
+    }
+  }
+  kinds.swap(rows.recorded());
+  return count;
 }
+
+// compresses consecutive planes of a 3D array, keeping the state of its
+// predictor and entropy coders between calls
+class SliceEncoder {
+public:
+  virtual ~SliceEncoder() {}
+
+  // compress nz more planes starting at data, optionally overlapping
+  // prediction and entropy coding
+  virtual void encode(const void* data, size_t nz, bool pipelined) = 0;
+
+  // start over with another array, reusing buffers and models; warm
+  // adaptive models continue from the statistics of the previous array
+  virtual void reset(bool warm) = 0;
+};
+
+// slice encoder for arrays of type T at given precision using coders E
+template <typename T, uint bits, class E>
+class SliceEncoderImpl : public SliceEncoder {
+public:
+  SliceEncoderImpl(E*const* re, const Coding& coding, size_t nx, size_t ny, size_t sy, size_t sz) :
+    re(re), coding(coding), nx(nx), ny(ny), sy(sy), sz(sz), fe(0), begun(false), warm(false), rows(0, nx, ny, 0, sy, sz, coding.adaptive)
+  {}
+  ~SliceEncoderImpl() { delete fe; }
+
+  // semi-static models are built from the planes passed in the first call,
+  // which must therefore comprise the whole array
+  void encode(const void* data, size_t nz, bool pipelined)
+  {
+    const T* p = static_cast<const T*>(data);
+    if (!begun) {
+      std::vector<uchar> kinds;
+      std::vector<uint64> count = coding.fixed() ? histogram<T, bits, E>(coding, p, nx, ny, nz, sy, sz, kinds) : std::vector<uint64>();
+      const uint64* c = count.empty() ? 0 : &count[0];
+      if (fe)
+        fe->reset(c, warm);
+      else
+        fe = new Encoder(re, coding.lanes, coding.model, c, nx, ny);
+      // reuse predictors selected while gathering statistics
+      rows.replay(kinds);
+      begun = true;
+    }
+    rows.append(p, nz);
+#ifdef FPZIP_WITH_OPENMP
+    if (pipelined && !coding.contextual() && !coding.adaptive && encode_pipelined(nx * ny * nz))
+      return;
+#else
+    (void)pipelined;
+#endif
+    // encode difference between predicted (p) and actual (r) value; the
+    // predictor selected for each row precedes it in the first lane
+    while (rows.next()) {
+      if (coding.adaptive)
+        re[0]->template encode<uint>(rows.kind(), FPZ_PRED_BITS);
+      fe->encode(rows.real(), rows.pred(), nx);
+    }
+  }
+
+  // models are reset once the first planes of the next array are passed
+  void reset(bool warm)
+  {
+    begun = false;
+    this->warm = warm;
+    rows.reset();
+  }
+
+private:
+  typedef typename PCrow<T, bits>::Map Map;
+  typedef typename Map::Domain D;
+  typedef LaneEncoder<D, Map, E> Encoder;
+  typedef typename Encoder::Residual Residual;
+
+#ifdef FPZIP_WITH_OPENMP
+  // encode n samples using a pipeline of two threads: one that predicts
+  // samples and maps residuals to symbols, and one that entropy codes those
+  // symbols; return false if only one thread is available
+  bool encode_pipelined(size_t n)
+  {
+    Ring<Residual> ring(8, 0x1000);
+    bool pipelined = true;
+
+    #pragma omp parallel num_threads(2)
+    {
+      if (omp_get_num_threads() < 2)
+        pipelined = false;
+      else if (omp_get_thread_num() == 0) {
+        // producer: map residuals to symbols and pass them on block by block
+        Residual* block = ring.acquire();
+        size_t i = 0;
+        while (rows.next()) {
+          const typename Map::Range* r = rows.real();
+          const typename Map::Range* p = rows.pred();
+          for (size_t x = 0; x < nx; x++) {
+            block[i++] = Encoder::residual(r[x], p[x]);
+            if (i == ring.block_size()) {
+              ring.publish(i);
+              block = ring.acquire();
+              i = 0;
+            }
+          }
+        }
+        if (i)
+          ring.publish(i);
+      }
+      else {
+        // consumer: entropy code symbols in order
+        for (size_t i = 0; i < n;) {
+          size_t m;
+          const Residual* block = ring.fetch(m);
+          fe->encode(block, m);
+          ring.release();
+          i += m;
+        }
+      }
+    }
+
+    return pipelined;
+  }
 #endif
 
-// compress p-bit float, 2p-bit double
-#define compress_case(p)\
+  E*const*           re;     // entropy encoder for each lane
+  const Coding       coding; // entropy coding options
+  const size_t       nx;     // number of x samples
+  const size_t       ny;     // number of y samples
+  const size_t       sy;     // distance between consecutive rows
+  const size_t       sz;     // distance between consecutive planes
+  Encoder*           fe;     // residual encoders, once constructed
+  bool               begun;  // have models been initialized for this array?
+  bool               warm;   // do adaptive models carry over from previous array?
+  Predictor<T, bits> rows;   // predictor of rows of planes passed so far
+};
+
+// construct slice encoder for p-bit float, 2p-bit double
+#define slice_encoder_case(p)\
   case subsize(T, p):\
-    compress3d<T, subsize(T, p)>(stream->re, data, stream->nx, stream->ny, stream->nz);\
-    break
+    return new SliceEncoderImpl<T, subsize(T, p), E>(re, coding, nx, ny, sy, sz)
+
+// construct slice encoder for 3D arrays of type T at given precision
+template <typename T, class E>
+static SliceEncoder*
+slice_encoder(
+  E*const*      re,     // entropy encoder for each lane
+  const Coding& coding, // entropy coding options
+  int           bits,   // number of bits of precision
+  size_t        nx,     // number of x samples
+  size_t        ny,     // number of y samples
+  size_t        sy,     // distance between consecutive rows
+  size_t        sz      // distance between consecutive planes
+)
+{
+  switch (bits) {
+    slice_encoder_case( 2);
+    slice_encoder_case( 3);
+    slice_encoder_case( 4);
+    slice_encoder_case( 5);
+    slice_encoder_case( 6);
+    slice_encoder_case( 7);
+    slice_encoder_case( 8);
+    slice_encoder_case( 9);
+    slice_encoder_case(10);
+    slice_encoder_case(11);
+    slice_encoder_case(12);
+    slice_encoder_case(13);
+    slice_encoder_case(14);
+    slice_encoder_case(15);
+    slice_encoder_case(16);
+    slice_encoder_case(17);
+    slice_encoder_case(18);
+    slice_encoder_case(19);
+    slice_encoder_case(20);
+    slice_encoder_case(21);
+    slice_encoder_case(22);
+    slice_encoder_case(23);
+    slice_encoder_case(24);
+    slice_encoder_case(25);
+    slice_encoder_case(26);
+    slice_encoder_case(27);
+    slice_encoder_case(28);
+    slice_encoder_case(29);
+    slice_encoder_case(30);
+    slice_encoder_case(31);
+    slice_encoder_case(32);
+    default:
+      return 0;
+  }
+}
+
+// is precision (in bits) supported for type T?
+template <typename T>
+static bool
+valid_precision(int bits)
+{
+  return (int)subsize(T, 2) <= bits && bits <= (int)subsize(T, 32) && !(bits % (int)subsize(T, 1));
+}
+
+// Compresses a 3D array into a range encoder a number of planes at a time.
+// Multiple lanes, rANS coded lanes, and lanes with raw bits are compressed
+// to their own memory buffers, which follow a table of their sizes once the
+// whole array has been compressed.
+class FieldEncoder {
+public:
+  FieldEncoder(RCencoder* re, const Coding& coding, int type, int bits, size_t nx, size_t ny, size_t sy, size_t sz) :
+    re(re), coding(coding), type(type), bits(bits), nx(nx), ny(ny), sy(sy), sz(sz), slices(0)
+  {
+    if (!coding.separate()) {
+      slices = create(&this->re);
+      return;
+    }
+    const uint lanes = coding.lanes;
+    const uint streams = coding.streams();
+    for (uint i = 0; i < streams; i++)
+      le.push_back(new RCdynencoder());
+    rc.assign(le.begin(), le.end());
+    RCencoder*const* raw = &rc[0] + lanes;
+    if (coding.coder == FPZIP_CODER_RANS) {
+      for (uint i = 0; i < lanes; i++)
+        ae.push_back(new ANSencoder(le[i]));
+      if (coding.bypass) {
+        for (uint i = 0; i < lanes; i++)
+          abe.push_back(new RAWencoder<ANSencoder>(ae[i], raw[i]));
+        slices = create(&abe[0]);
+      }
+      else
+        slices = create(&ae[0]);
+    }
+    else {
+      if (coding.bypass) {
+        for (uint i = 0; i < lanes; i++)
+          rbe.push_back(new RAWencoder<RCencoder>(rc[i], raw[i]));
+        slices = create(&rbe[0]);
+      }
+      else
+        slices = create(&rc[0]);
+    }
+  }
+
+  ~FieldEncoder()
+  {
+    delete slices;
+    for (uint i = 0; i < abe.size(); i++)
+      delete abe[i];
+    for (uint i = 0; i < rbe.size(); i++)
+      delete rbe[i];
+    for (uint i = 0; i < ae.size(); i++)
+      delete ae[i];
+    for (uint i = 0; i < le.size(); i++)
+      delete le[i];
+  }
+
+  // is the precision supported?
+  bool valid() const { return slices != 0; }
+
+  // does the encoder compress arrays with the given layout and options?
+  bool matches(const Coding& coding, int type, int bits, size_t nx, size_t ny, size_t sy, size_t sz) const
+  {
+    return this->coding == coding && this->type == type && this->bits == bits &&
+           this->nx == nx && this->ny == ny && this->sy == sy && this->sz == sz;
+  }
+
+  // start over with another array to be written to re, keeping all buffers
+  // and resetting models in place unless warm
+  void reset(RCencoder* re, bool warm)
+  {
+    this->re = re;
+    for (uint i = 0; i < le.size(); i++)
+      le[i]->rewind();
+    for (uint i = 0; i < ae.size(); i++)
+      ae[i]->reset();
+    for (uint i = 0; i < rbe.size(); i++)
+      rbe[i]->reset();
+    for (uint i = 0; i < abe.size(); i++)
+      abe[i]->reset();
+    if (slices)
+      slices->reset(warm);
+  }
+
+  // compress nz more planes starting at data
+  void encode(const void* data, size_t nz, bool pipelined) { slices->encode(data, nz, pipelined); }
+
+  // finish compression once all planes have been compressed
+  void finish()
+  {
+    if (!coding.separate())
+      return;
+
+    // flush raw bits and finish entropy coding of each lane
+    for (uint i = 0; i < abe.size(); i++)
+      abe[i]->finish();
+    for (uint i = 0; i < rbe.size(); i++)
+      rbe[i]->finish();
+    if (coding.coder == FPZIP_CODER_RANS)
+      for (uint i = 0; i < ae.size(); i++)
+        ae[i]->finish();
+    else
+      for (uint i = 0; i < coding.lanes; i++)
+        le[i]->finish();
+
+    // write table of stream sizes followed by streams
+    for (uint i = 0; i < le.size(); i++)
+      re->encode<uint64>(le[i]->bytes(), 64);
+    re->finish();
+    for (uint i = 0; i < le.size(); i++) {
+      if (le[i]->error)
+        re->error = true;
+      re->putbytes(le[i]->data(), le[i]->bytes());
+    }
+  }
+
+private:
+  FieldEncoder(const FieldEncoder&);
+  FieldEncoder& operator=(const FieldEncoder&);
+
+  // construct slice encoder for arrays of given type using coders e
+  template <class E>
+  SliceEncoder* create(E*const* e) const
+  {
+    return type == FPZIP_TYPE_FLOAT
+      ? slice_encoder<float, E>(e, coding, bits, nx, ny, sy, sz)
+      : slice_encoder<double, E>(e, coding, bits, nx, ny, sy, sz);
+  }
+
+  RCencoder*                            re;     // entropy encoder of stream
+  const Coding                          coding; // entropy coding options
+  const int                             type;   // type of array
+  const int                             bits;   // number of bits of precision
+  const size_t                          nx;     // number of x samples
+  const size_t                          ny;     // number of y samples
+  const size_t                          sy;     // distance between consecutive rows
+  const size_t                          sz;     // distance between consecutive planes
+  std::vector<RCdynencoder*>            le;     // lanes followed by their raw bits
+  std::vector<RCencoder*>               rc;     // le as range encoders
+  std::vector<ANSencoder*>              ae;     // rANS encoder for each lane
+  std::vector<RAWencoder<RCencoder>*>   rbe;    // range and raw bit encoders
+  std::vector<RAWencoder<ANSencoder>*>  abe;    // rANS and raw bit encoders
+  SliceEncoder*                         slices; // encoder of planes
+};
+
+// compress 3D (sub)array of given type at given precision
+static bool
+compress3d(
+  RCencoder*    re,       // entropy encoder
+  int           type,     // type of array
+  const void*   data,     // first sample of 3D array to compress
+  int           bits,     // number of bits of precision
+  const Coding& coding,   // entropy coding options
+  size_t        nx,       // number of x samples
+  size_t        ny,       // number of y samples
+  size_t        nz,       // number of z samples
+  size_t        sy,       // distance between consecutive rows
+  size_t        sz,       // distance between consecutive planes
+  bool          pipelined // overlap prediction and entropy coding?
+)
+{
+  FieldEncoder field(re, coding, type, bits, nx, ny, sy, sz);
+  if (!field.valid())
+    return false;
+  field.encode(data, nz, pipelined);
+  field.finish();
+  return true;
+}
+
+// encoder of next field of stream, which reuses the encoder of the
+// previous field when the array layout and coding options are unchanged
+static FieldEncoder*
+field_encoder(
+  FPZoutput*    stream, // output stream
+  const Coding& coding, // entropy coding options
+  int           bits    // number of bits of precision
+)
+{
+  const size_t nx = stream->nx;
+  const size_t ny = stream->ny;
+  const size_t sy = nx;
+  const size_t sz = nx * ny;
+  if (stream->cache && stream->cache->matches(coding, stream->type, bits, nx, ny, sy, sz))
+    stream->cache->reset(stream->re, false);
+  else {
+    delete stream->cache;
+    stream->cache = 0;
+    stream->cache = new FieldEncoder(stream->re, coding, stream->type, bits, nx, ny, sy, sz);
+  }
+  return stream->cache;
+}
+
+// Overlap prediction and entropy coding of n samples when the caller has
+// asked for two or more threads, multiple processors are available, and n
+// is large enough to amortize the overhead of synchronization.  Pipelining
+// is not the default, as callers that compress many arrays concurrently
+// would otherwise oversubscribe the processors.
+static bool
+pipeline(
+  const FPZ* stream, // output stream
+  size_t     n       // number of samples to compress
+)
+{
+#ifdef FPZIP_WITH_OPENMP
+  return stream->threads > 1 && omp_get_num_procs() > 1 && n >= 0x10000;
+#else
+  (void)stream;
+  (void)n;
+  return false;
+#endif
+}
 
 // compress 4D array
 template <typename T>
@@ -160,50 +1109,404 @@ compress4d(
   const T*   data    // flattened 4D array to compress
 )
 {
+  int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * sizeof(T));
+  size_t nx = stream->nx;
+  size_t ny = stream->ny;
+  size_t nz = stream->nz;
+  Coding coding(stream);
+  bool pipelined = pipeline(stream, nx * ny * nz);
   // compress one field at a time
-  for (int i = 0; i < stream->nf; i++) {
-    int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * sizeof(T));
-    switch (bits) {
-      compress_case( 2);
-      compress_case( 3);
-      compress_case( 4);
-      compress_case( 5);
-      compress_case( 6);
-      compress_case( 7);
-      compress_case( 8);
-      compress_case( 9);
-      compress_case(10);
-      compress_case(11);
-      compress_case(12);
-      compress_case(13);
-      compress_case(14);
-      compress_case(15);
-      compress_case(16);
-      compress_case(17);
-      compress_case(18);
-      compress_case(19);
-      compress_case(20);
-      compress_case(21);
-      compress_case(22);
-      compress_case(23);
-      compress_case(24);
-      compress_case(25);
-      compress_case(26);
-      compress_case(27);
-      compress_case(28);
-      compress_case(29);
-      compress_case(30);
-      compress_case(31);
-      compress_case(32);
-      default:
-        fpzip_errno = fpzipErrorBadPrecision;
-        return false;
+  for (size_t i = 0; i < stream->nf; i++) {
+    FieldEncoder* field = field_encoder(stream, coding, bits);
+    if (!field->valid()) {
+      fpzip_errno = fpzipErrorBadPrecision;
+      return false;
     }
-    data += stream->nx * stream->ny * stream->nz;
+    field->encode(data, nz, pipelined);
+    field->finish();
+    data += nx * ny * nz;
   }
   return true;
 }
 
+// compress 4D array as independent chunks
+template <typename T>
+static bool
+compress4d_chunked(
+  FPZoutput* stream, // output stream
+  const T*   data    // flattened 4D array to compress
+)
+{
+  int bits = stream->prec ? stream->prec : (int)(CHAR_BIT * sizeof(T));
+  if (!valid_precision<T>(bits)) {
+    fpzip_errno = fpzipErrorBadPrecision;
+    return false;
+  }
+
+  // compress each chunk to its own memory buffer
+  const Chunking chunking(stream);
+  if (chunking.count() > INT_MAX) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return false;
+  }
+  const int n = (int)chunking.count();
+  const Coding coding(stream);
+  std::vector<RCdynencoder*> ce(n, static_cast<RCdynencoder*>(0));
+#ifdef FPZIP_WITH_OPENMP
+  int threads = stream->threads > 0 ? stream->threads : omp_get_max_threads();
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+#endif
+  for (int i = 0; i < n; i++) {
+    try {
+      size_t nx, ny, nz;
+      size_t offset = chunking.chunk(i, nx, ny, nz);
+      ce[i] = new RCdynencoder();
+      compress3d(ce[i], stream->type, data + offset, bits, coding, nx, ny, nz, chunking.nx, chunking.nx * chunking.ny, false);
+      // separately coded lanes end in raw bytes that need no finalization
+      if (!coding.separate())
+        ce[i]->finish();
+    }
+    catch (...) {
+      // exceptions cannot propagate out of a parallel region
+      if (ce[i])
+        ce[i]->error = true;
+    }
+  }
+
+  // write table of chunk sizes followed by compressed chunks
+  bool success = true;
+  RCencoder* re = stream->re;
+  for (int i = 0; i < n && success; i++)
+    if (!ce[i] || ce[i]->error) {
+      fpzip_errno = fpzipErrorInternal;
+      success = false;
+    }
+  if (success) {
+    for (int i = 0; i < n; i++)
+      re->encode<uint64>(ce[i]->bytes(), 64);
+    re->finish();
+    for (int i = 0; i < n; i++)
+      re->putbytes(ce[i]->data(), ce[i]->bytes());
+  }
+  for (int i = 0; i < n; i++)
+    delete ce[i];
+
+  return success;
+}
+
+// compress segment of batch items to re, reusing the field encoder and
+// its warm adaptive models for consecutive fields of the same layout
+static void
+compress_segment(
+  RCencoder*              re,     // entropy encoder of segment
+  const Coding&           coding, // entropy coding options
+  const fpzip_batch_item* item,   // arrays of batch
+  const BatchItem*        meta,   // meta data of arrays
+  uint                    first,  // first item of segment
+  uint                    last    // one past last item of segment
+)
+{
+  FieldEncoder* field = 0;
+  try {
+    for (uint i = first; i < last; i++) {
+      const BatchItem& b = meta[i];
+      const int bits = b.bits();
+      const size_t sy = b.nx;
+      const size_t sz = b.nx * b.ny;
+      const uchar* p = static_cast<const uchar*>(item[i].data);
+      for (size_t f = 0; f < b.nf; f++) {
+        if (field && field->matches(coding, b.type, bits, b.nx, b.ny, sy, sz))
+          field->reset(re, true);
+        else {
+          delete field;
+          field = 0;
+          field = new FieldEncoder(re, coding, b.type, bits, b.nx, b.ny, sy, sz);
+        }
+        field->encode(p, b.nz, false);
+        field->finish();
+        p += b.bytes() / b.nf;
+      }
+    }
+  }
+  catch (...) {
+    delete field;
+    throw;
+  }
+  delete field;
+}
+
+// encode count n as its number of significant bits followed by the bits
+static void
+encode_count(
+  RCencoder* re, // entropy encoder
+  uint64     n   // count to encode
+)
+{
+  uint bits = 0;
+  while (bits < 64 && (n >> bits))
+    bits++;
+  re->encode<uint>(bits, 7);
+  if (bits)
+    re->encode<uint64>(n, bits);
+}
+
+// write magic and format version
+static void
+write_version(
+  RCencoder* re,     // entropy encoder
+  uint       version // format version
+)
+{
+  re->encode<uint>('f', 8);
+  re->encode<uint>('p', 8);
+  re->encode<uint>('z', 8);
+  re->encode<uint>('\0', 8);
+  re->encode<uint>(version, 16);
+  re->encode<uint>(FPZ_MIN_VERSION, 8);
+}
+
+// coding options that differ from their defaults
+static uint
+coding_options(
+  const FPZ* fpz // stream handle
+)
+{
+  uint options = 0;
+  if (fpz->lanes > 1)
+    options |= FPZ_OPT_LANES;
+  if (fpz->coder != FPZIP_CODER_RANGE)
+    options |= FPZ_OPT_CODER;
+  if (fpz->model != FPZIP_MODEL_ADAPTIVE)
+    options |= FPZ_OPT_MODEL;
+  if (fpz->bypass)
+    options |= FPZ_OPT_BYPASS;
+  if (fpz->predictor != FPZIP_PREDICTOR_LORENZO)
+    options |= FPZ_OPT_PREDICTOR;
+  return options;
+}
+
+// write values of flagged coding options
+static void
+write_options(
+  RCencoder* re,     // entropy encoder
+  const FPZ* fpz,    // stream handle
+  uint       options // flags of options present
+)
+{
+  if (options & FPZ_OPT_LANES)
+    re->encode<uint>(fpz->lanes, 8);
+  if (options & FPZ_OPT_CODER)
+    re->encode<uint>(fpz->coder, 8);
+  if (options & FPZ_OPT_MODEL)
+    re->encode<uint>(fpz->model, 8);
+  if (options & FPZ_OPT_PREDICTOR)
+    re->encode<uint>(fpz->predictor, 8);
+}
+
+// compress batch of arrays as segments of consecutive arrays, each coded
+// independently of all others
+static bool
+compress_batch(
+  FPZoutput*                    stream, // output stream
+  const fpzip_batch_item*       item,   // arrays of batch
+  const std::vector<BatchItem>& meta    // meta data of arrays
+)
+{
+  // compress each segment to its own memory buffer
+  const Batching batching(meta);
+  const int n = batching.count();
+  const Coding coding(stream);
+  std::vector<RCdynencoder*> ce(n, static_cast<RCdynencoder*>(0));
+#ifdef FPZIP_WITH_OPENMP
+  int threads = stream->threads > 0 ? stream->threads : omp_get_max_threads();
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+#endif
+  for (int s = 0; s < n; s++) {
+    try {
+      ce[s] = new RCdynencoder();
+      compress_segment(ce[s], coding, item, &meta[0], batching.first(s), batching.last(s));
+      // separately coded lanes end in raw bytes that need no finalization
+      if (!coding.separate())
+        ce[s]->finish();
+    }
+    catch (...) {
+      // exceptions cannot propagate out of a parallel region
+      if (ce[s])
+        ce[s]->error = true;
+    }
+  }
+
+  bool success = true;
+  for (int s = 0; s < n && success; s++)
+    if (!ce[s] || ce[s]->error) {
+      fpzip_errno = fpzipErrorInternal;
+      success = false;
+    }
+
+  if (success) {
+    // header with coding options shared by all arrays
+    RCencoder* re = stream->re;
+    uint options = FPZ_OPT_BATCH | coding_options(stream);
+    write_version(re, FPZ_EXT_VERSION);
+    re->encode<uint>(options, 16);
+    write_options(re, stream, options);
+    re->encode<uint>((uint)meta.size(), 32);
+
+    // meta data of each array, unless the same as that of the previous one
+    for (uint i = 0; i < meta.size(); i++) {
+      const BatchItem& b = meta[i];
+      bool repeated = i && b == meta[i - 1];
+      if (i)
+        re->encode(repeated);
+      if (!repeated) {
+        re->encode<uint>(b.type, 1);
+        re->encode<uint>(b.prec, 7);
+        encode_count(re, b.nx);
+        encode_count(re, b.ny);
+        encode_count(re, b.nz);
+        encode_count(re, b.nf);
+      }
+    }
+
+    // table of segment sizes followed by compressed segments
+    for (int s = 0; s < n; s++)
+      encode_count(re, ce[s]->bytes());
+    re->finish();
+    for (int s = 0; s < n; s++)
+      re->putbytes(ce[s]->data(), ce[s]->bytes());
+  }
+  for (int s = 0; s < n; s++)
+    delete ce[s];
+
+  return success;
+}
+
+// are the coding options of a stream valid?
+static bool
+valid_options(
+  const FPZ* fpz // stream handle
+)
+{
+  return 0 <= fpz->lanes && fpz->lanes <= FPZ_MAX_LANES &&
+         (fpz->coder == FPZIP_CODER_RANGE || fpz->coder == FPZIP_CODER_RANS) &&
+         FPZIP_MODEL_ADAPTIVE <= fpz->model && fpz->model <= FPZIP_MODEL_CONTEXT &&
+         (fpz->bypass == 0 || fpz->bypass == 1) &&
+         (fpz->predictor == FPZIP_PREDICTOR_LORENZO || fpz->predictor == FPZIP_PREDICTOR_ADAPTIVE);
+}
+
+// options of extended header needed by a single-array stream; zero if the
+// original header suffices
+static uint
+header_options(
+  const FPZ* fpz // stream handle
+)
+{
+  uint options = coding_options(fpz);
+  if ((uint64)fpz->nx >> 32 || (uint64)fpz->ny >> 32 || (uint64)fpz->nz >> 32 || (uint64)fpz->nf >> 32)
+    options |= FPZ_OPT_WIDE;
+  if (Chunking::enabled(fpz))
+    options |= FPZ_OPT_CHUNKED;
+  return options;
+}
+
+// Worst-case compressed sizes.  The carryless range coder outputs at most
+// three bytes per symbol or number of at most 16 bits that it codes: its
+// range is at least 2^16 before and at least one after coding, and is then
+// scaled back up either by shifting out at most three bytes or by shifting
+// out at most one and fudging the range with two more.  Finishing the range
+// coder outputs four bytes.  Because all frequency totals are at most 2^16,
+// the rANS coder spends less than 16 + 1/16 bits per symbol or number,
+// plus a four-byte state and a byte of rounding per segment.  Raw bits are
+// packed with less than one byte of padding per lane.
+
+#define FPZ_HEADER_NUMBERS 27 // numbers of at most 16 bits coded in header
+#define FPZ_WIDE_NUMBERS    8 // additional numbers for 64-bit dimensions
+
+// worst-case number of bytes output by compress3d() for units 3D arrays of
+// n samples in total, each sample being coded using bits bits of precision,
+// and rows rows in total
+static uint64
+bound3d(
+  const Coding& coding, // entropy coding options
+  uint          bits,   // number of bits of precision
+  uint64        n,      // total number of samples
+  uint64        rows,   // total number of rows
+  uint64        units   // number of separately compressed 3D arrays
+)
+{
+  // each sample is coded as a residual symbol followed, for large alphabets,
+  // by up to bits - 1 verbatim bits split into numbers of at most 16 bits
+  const bool wide = bits > PC_BIT_MAX;
+  const uint64 symbols = wide ? 2 * bits + 1 : (2u << bits) - 1;
+  const uint64 k = wide ? bits - 1 : 0;
+  const uint64 numbers = (k + 15) / 16;
+  // semi-static models write a frequency table per lane as two 16-bit
+  // numbers and up to two numbers of 5 and 12 bits per symbol
+  const uint64 table = coding.fixed() ? 2 + 2 * symbols : 0;
+  const uint64 table_bits = coding.fixed() ? 32 + 17 * symbols : 0;
+  // adaptive prediction codes the predictor of each row as a number
+  const uint64 predictors = coding.adaptive ? rows : 0;
+
+  if (!coding.separate())
+    return 3 * (n * (1 + numbers) + predictors + units * table);
+
+  // with raw bit bypass, numbers, including those of frequency tables and
+  // predictors, are written to a raw bit stream per lane
+  const uint64 lanes = units * coding.lanes;
+  const uint64 calls = coding.bypass ? n : n * (1 + numbers) + predictors + lanes * table;
+  uint64 bytes = 0;
+  if (coding.coder == FPZIP_CODER_RANS) {
+    uint64 coded = coding.bypass ? 16 * n : n * (16 + k) + FPZ_PRED_BITS * predictors + lanes * table_bits;
+    coded += calls / 16 + lanes;
+    uint64 segments = calls / ANS_SEGMENT + lanes;
+    bytes += (coded + 7) / 8 + lanes + 5 * segments;
+  }
+  else
+    bytes += 3 * calls + 4 * lanes;
+  if (coding.bypass)
+    bytes += (n * k + FPZ_PRED_BITS * predictors + lanes * table_bits + 7) / 8 + lanes;
+  // table of stream sizes, each coded as four numbers, and finish
+  bytes += units * (3 * 4 * coding.streams() + 4);
+  return bytes;
+}
+
+// worst-case number of bytes written by fpzip_write_header() and
+// fpzip_write() for an array of type T
+template <typename T>
+static uint64
+bound4d(
+  const FPZ* fpz // stream handle
+)
+{
+  int bits = fpz->prec ? fpz->prec : (int)(CHAR_BIT * sizeof(T));
+  if (!valid_precision<T>(bits)) {
+    fpzip_errno = fpzipErrorBadPrecision;
+    return 0;
+  }
+  const Coding coding(fpz);
+  const uint64 n = (uint64)fpz->nx * fpz->ny * fpz->nz * fpz->nf;
+  uint64 bytes = 3 * FPZ_HEADER_NUMBERS;
+  if (header_options(fpz) & FPZ_OPT_WIDE)
+    bytes += 3 * FPZ_WIDE_NUMBERS;
+  if (Chunking::enabled(fpz)) {
+    // table of chunk sizes followed by independently coded chunks
+    const Chunking chunking(fpz);
+    const uint64 chunks = chunking.count();
+    const uint64 rows = (uint64)chunking.mx * fpz->ny * fpz->nz * fpz->nf;
+    bytes += 3 * 4 * chunks + 4;
+    bytes += bound3d(coding, bits, n, rows, chunks);
+    if (!coding.separate())
+      bytes += 4 * chunks;
+  }
+  else {
+    const uint64 rows = fpz->nx ? (uint64)fpz->ny * fpz->nz * fpz->nf : 0;
+    bytes += bound3d(coding, bits, n, rows, fpz->nf);
+    if (!coding.separate())
+      bytes += 4;
+  }
+  return bytes;
+}
+
 // write compressed stream to file
 FPZ*
 fpzip_write_to_file(
@@ -226,6 +1529,59 @@ fpzip_write_to_buffer(
   fpzip_errno = fpzipSuccess;
   FPZoutput* stream = allocate_output();
   stream->re = new RCmemencoder(buffer, size);
+  stream->failure = fpzipErrorBufferOverflow;
+  return static_cast<FPZ*>(stream);
+}
+
+// write compressed stream to memory buffer, recycling a stream closed
+// earlier in the same context
+FPZ*
+fpzip_context_write_to_buffer(
+  fpzip_context* ctx,    // context
+  void*          buffer, // pointer to compressed data
+  size_t         size    // size of buffer
+)
+{
+  fpzip_errno = fpzipSuccess;
+  if (!ctx) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  FPZoutput* stream = ctx->output;
+  if (stream) {
+    ctx->output = 0;
+    reset_output(stream);
+    static_cast<RCmemencoder*>(stream->re)->open(buffer, size);
+  }
+  else {
+    stream = allocate_output();
+    stream->re = new RCmemencoder(buffer, size);
+    stream->context = ctx;
+  }
+  stream->failure = fpzipErrorBufferOverflow;
+  return static_cast<FPZ*>(stream);
+}
+
+// write compressed stream to user function
+FPZ*
+fpzip_write_to_callback(
+  fpzip_write_func func, // function that consumes compressed data
+  void*            ctx   // user data passed to func
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = allocate_output();
+  stream->re = new RCfuncencoder(func, ctx);
+  return static_cast<FPZ*>(stream);
+}
+
+// write compressed stream to memory buffer that grows as needed
+FPZ*
+fpzip_write_to_memory()
+{
+  fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = allocate_output();
+  stream->re = new RCdynencoder();
   return static_cast<FPZ*>(stream);
 }
 
@@ -236,10 +1592,45 @@ fpzip_write_close(
 )
 {
   FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  // return stream to its context unless the context already holds one
+  fpzip_context* ctx = stream->context;
+  if (ctx && !ctx->output)
+    ctx->output = stream;
+  else
+    fpzip_free_output(stream);
+}
+
+// deallocate output stream and all of its state
+void
+fpzip_free_output(
+  FPZoutput* stream // output stream
+)
+{
+  delete stream->cache;
   delete stream->re;
   delete stream;
 }
 
+// close stream for writing to memory and return its buffer
+void*
+fpzip_write_close_memory(
+  FPZ*    fpz, // stream handle
+  size_t* size // number of bytes in buffer
+)
+{
+  FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  RCdynencoder* re = dynamic_cast<RCdynencoder*>(stream->re);
+  void* buffer = 0;
+  if (re && !re->error) {
+    *size = re->bytes();
+    buffer = re->release();
+  }
+  else
+    *size = 0;
+  fpzip_write_close(fpz);
+  return buffer;
+}
+
 // write meta data
 int
 fpzip_write_header(
@@ -251,34 +1642,99 @@ fpzip_write_header(
   FPZoutput* stream = static_cast<FPZoutput*>(fpz);
   RCencoder* re = stream->re;
 
-  // magic
-  re->encode<uint>('f', 8);
-  re->encode<uint>('p', 8);
-  re->encode<uint>('z', 8);
-  re->encode<uint>('\0', 8);
+  if (!valid_options(stream)) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
 
-  // format version
-  re->encode<uint>(FPZ_MAJ_VERSION, 16);
-  re->encode<uint>(FPZ_MIN_VERSION, 8);
+  // magic and format version; use the original format unless the stream
+  // needs options of the extended header
+  uint options = header_options(stream);
+  write_version(re, options ? FPZ_EXT_VERSION : FPZ_MAJ_VERSION);
+  if (options)
+    re->encode<uint>(options, 16);
 
   // type and precision
   re->encode<uint>(stream->type, 1);
   re->encode<uint>(stream->prec, 7);
 
   // array dimensions
-  re->encode<uint>(stream->nx, 32);
-  re->encode<uint>(stream->ny, 32);
-  re->encode<uint>(stream->nz, 32);
-  re->encode<uint>(stream->nf, 32);
+  uint width = options & FPZ_OPT_WIDE ? 64 : 32;
+  re->encode<uint64>(stream->nx, width);
+  re->encode<uint64>(stream->ny, width);
+  re->encode<uint64>(stream->nz, width);
+  re->encode<uint64>(stream->nf, width);
+
+  // chunk dimensions
+  if (options & FPZ_OPT_CHUNKED) {
+    Chunking chunking(stream);
+    re->encode<uint>((uint)chunking.cx, 32);
+    re->encode<uint>((uint)chunking.cy, 32);
+    re->encode<uint>((uint)chunking.cz, 32);
+  }
+
+  // coding options
+  write_options(re, stream, options);
 
   if (re->error) {
-    fpzip_errno = fpzipErrorWriteStream;
+    fpzip_errno = stream->failure;
     return 0;
   }
 
   return 1;
 }
 
+// upper bound on size of compressed stream
+size_t
+fpzip_compress_bound(
+  const FPZ* fpz // stream handle with array meta data
+)
+{
+  fpzip_errno = fpzipSuccess;
+  if (!valid_options(fpz) || (fpz->type != FPZIP_TYPE_FLOAT && fpz->type != FPZIP_TYPE_DOUBLE)) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  uint64 bytes = fpz->type == FPZIP_TYPE_FLOAT ? bound4d<float>(fpz) : bound4d<double>(fpz);
+  if (bytes != (size_t)bytes) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  return (size_t)bytes;
+}
+
+// number of bits of precision of a stream
+static int
+precision(
+  const FPZ* stream // output stream
+)
+{
+  if (stream->prec)
+    return stream->prec;
+  return (int)(CHAR_BIT * (stream->type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double)));
+}
+
+// finish writing compressed array; return total number of bytes written
+static size_t
+finish_output(
+  FPZoutput* stream // output stream
+)
+{
+  RCencoder* re = stream->re;
+  // chunked streams and streams with separately coded lanes end in raw
+  // bytes that need no finalization
+  if (Chunking::enabled(stream) || Coding(stream).separate())
+    re->flush();
+  else
+    re->finish();
+  if (re->error) {
+    if (fpzip_errno == fpzipSuccess)
+      fpzip_errno = stream->failure;
+    return 0;
+  }
+  return re->bytes();
+}
+
 // compress a single- or double-precision 4D array
 size_t
 fpzip_write(
@@ -287,19 +1743,184 @@ fpzip_write(
 )
 {
   fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  if (stream->begun) {
+    // an array is being compressed a number of slices at a time
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
   size_t bytes = 0;
   try {
-    FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+    bool chunked = Chunking::enabled(stream);
     bool success = (stream->type == FPZIP_TYPE_FLOAT
-      ? compress4d(stream, static_cast<const float*>(data))
-      : compress4d(stream, static_cast<const double*>(data)));
-    if (success) {
-      RCencoder* re = stream->re;
-      re->finish();
-      if (re->error) {
-        if (fpzip_errno == fpzipSuccess)
-          fpzip_errno = fpzipErrorWriteStream;
+      ? chunked
+        ? compress4d_chunked(stream, static_cast<const float*>(data))
+        : compress4d(stream, static_cast<const float*>(data))
+      : chunked
+        ? compress4d_chunked(stream, static_cast<const double*>(data))
+        : compress4d(stream, static_cast<const double*>(data)));
+    if (success)
+      bytes = finish_output(stream);
+  }
+  catch (...) {
+    // exceptions indicate unrecoverable internal errors
+    fpzip_errno = fpzipErrorInternal;
+  }
+  return bytes;
+}
+
+// begin compressing array a number of slices at a time
+int
+fpzip_write_begin(
+  FPZ* fpz // stream handle
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  if (stream->begun || !valid_options(stream) || Chunking::enabled(stream) || stream->model == FPZIP_MODEL_STATIC ||
+      (stream->type != FPZIP_TYPE_FLOAT && stream->type != FPZIP_TYPE_DOUBLE)) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  int bits = precision(stream);
+  if (stream->type == FPZIP_TYPE_FLOAT ? !valid_precision<float>(bits) : !valid_precision<double>(bits)) {
+    fpzip_errno = fpzipErrorBadPrecision;
+    return 0;
+  }
+  stream->begun = true;
+  stream->slice = 0;
+  stream->field = 0;
+  return 1;
+}
+
+// compress next nslices z slices of array, continuing across fields
+int
+fpzip_write_slices(
+  FPZ*        fpz,    // stream handle
+  const void* data,   // consecutive slices to write
+  int         nslices // number of slices
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  const size_t nx = stream->nx;
+  const size_t ny = stream->ny;
+  const size_t nz = stream->nz;
+  if (!stream->begun || nslices < 0 || stream->slice + (uint64)nslices > (uint64)nz * stream->nf) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  try {
+    const Coding coding(stream);
+    const int type = stream->type;
+    const int bits = precision(stream);
+    const size_t size = nx * ny * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+    const uchar* p = static_cast<const uchar*>(data);
+    for (size_t n = nslices; n;) {
+      // compress as many slices as remain in current field
+      size_t z = (size_t)(stream->slice % nz);
+      size_t m = std::min(n, nz - z);
+      if (!stream->field)
+        stream->field = field_encoder(stream, coding, bits);
+      stream->field->encode(p, m, pipeline(stream, nx * ny * m));
+      p += m * size;
+      n -= m;
+      stream->slice += m;
+      // finish field once all of its slices have been compressed
+      if (z + m == nz) {
+        stream->field->finish();
+        stream->field = 0;
       }
+    }
+  }
+  catch (...) {
+    // exceptions indicate unrecoverable internal errors
+    fpzip_errno = fpzipErrorInternal;
+    stream->begun = false;
+    return 0;
+  }
+  if (stream->re->error) {
+    fpzip_errno = stream->failure;
+    return 0;
+  }
+  return 1;
+}
+
+// finish compressing array once all of its slices have been written
+size_t
+fpzip_write_end(
+  FPZ* fpz // stream handle
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  if (!stream->begun || stream->slice != (uint64)stream->nz * stream->nf) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  stream->begun = false;
+  size_t bytes = 0;
+  try {
+    // fields without slices were never started
+    if (!stream->nz) {
+      const Coding coding(stream);
+      const int bits = precision(stream);
+      for (size_t i = 0; i < stream->nf; i++) {
+        FieldEncoder* field = field_encoder(stream, coding, bits);
+        field->encode(0, 0, false);
+        field->finish();
+      }
+    }
+    bytes = finish_output(stream);
+  }
+  catch (...) {
+    // exceptions indicate unrecoverable internal errors
+    fpzip_errno = fpzipErrorInternal;
+  }
+  return bytes;
+}
+
+// compress batch of single- or double-precision 4D arrays
+size_t
+fpzip_write_batch(
+  FPZ*                    fpz,  // stream handle with coding options
+  const fpzip_batch_item* item, // arrays to write
+  int                     n     // number of arrays
+)
+{
+  fpzip_errno = fpzipSuccess;
+  FPZoutput* stream = static_cast<FPZoutput*>(fpz);
+  if (n < 0 || (n && !item) || stream->begun || !valid_options(stream) || Chunking::enabled(stream)) {
+    fpzip_errno = fpzipErrorBadArgument;
+    return 0;
+  }
+  std::vector<BatchItem> meta;
+  meta.reserve(n);
+  for (int i = 0; i < n; i++) {
+    const FPZ* b = &item[i].fpz;
+    if (b->type != FPZIP_TYPE_FLOAT && b->type != FPZIP_TYPE_DOUBLE) {
+      fpzip_errno = fpzipErrorBadArgument;
+      return 0;
+    }
+    meta.push_back(BatchItem(b));
+    if (meta[i].samples() && !item[i].data) {
+      fpzip_errno = fpzipErrorBadArgument;
+      return 0;
+    }
+    int bits = meta[i].bits();
+    if (b->type == FPZIP_TYPE_FLOAT ? !valid_precision<float>(bits) : !valid_precision<double>(bits)) {
+      fpzip_errno = fpzipErrorBadPrecision;
+      return 0;
+    }
+  }
+  size_t bytes = 0;
+  try {
+    if (compress_batch(stream, item, meta)) {
+      // the batch ends in raw bytes that need no finalization
+      RCencoder* re = stream->re;
+      re->flush();
+      if (re->error)
+        fpzip_errno = stream->failure;
       else
         bytes = re->bytes();
     }
@@ -1,73 +1,162 @@
 #ifndef FPZIP_WRITE_H
 #define FPZIP_WRITE_H
 
+#include <vector>
 #include "types.h"
 
 #define subsize(T, n) (CHAR_BIT * sizeof(T) * (n) / 32)
 
 // file writer for compressed data
-#if FPZIP_BLOCK_SIZE > 1
 class RCfileencoder : public RCencoder {
 public:
-  RCfileencoder(FILE* file) : RCencoder(), file(file), count(0), size(0) {}
-  ~RCfileencoder() { flush(); }
-  void putbyte(uint byte)
+  RCfileencoder(FILE* file) : RCencoder(), file(file), count(0)
   {
-    if (size == FPZIP_BLOCK_SIZE)
-      flush();
-    buffer[size++] = (uchar)byte;
+    ptr = buffer;
+    end = buffer + FPZIP_BLOCK_SIZE;
   }
+  ~RCfileencoder() { flush(); }
   void flush()
   {
+    size_t size = ptr - buffer;
     if (fwrite(buffer, 1, size, file) != size)
       error = true;
     else
       count += size;
-    size = 0;
+    ptr = buffer;
   }
   size_t bytes() const { return count; }
+protected:
+  void overflow(const void* data, size_t n)
+  {
+    flush();
+    if (n < FPZIP_BLOCK_SIZE) {
+      memcpy(ptr, data, n);
+      ptr += n;
+    }
+    else if (fwrite(data, 1, n, file) != n)
+      error = true;
+    else
+      count += n;
+  }
 private:
   FILE* file;
   size_t count;
-  size_t size;
   uchar buffer[FPZIP_BLOCK_SIZE];
 };
-#else
-class RCfileencoder : public RCencoder {
+
+// callback writer for compressed data, which hands the function blocks
+// larger than those written to files
+class RCfuncencoder : public RCencoder {
 public:
-  RCfileencoder(FILE* file) : RCencoder(), file(file), count(0) {}
-  void putbyte(uint byte)
+  RCfuncencoder(fpzip_write_func func, void* ctx) : RCencoder(), func(func), ctx(ctx), count(0), buffer(block)
+  {
+    ptr = &buffer[0];
+    end = ptr + block;
+  }
+  ~RCfuncencoder() { flush(); }
+  void flush()
   {
-    if (fputc(byte, file) == EOF)
+    size_t size = ptr - &buffer[0];
+    if (size && func(ctx, &buffer[0], size) != size)
       error = true;
     else
-      count++;
+      count += size;
+    ptr = &buffer[0];
   }
   size_t bytes() const { return count; }
+protected:
+  void overflow(const void* data, size_t n)
+  {
+    flush();
+    if (n < block) {
+      memcpy(ptr, data, n);
+      ptr += n;
+    }
+    else if (func(ctx, data, n) != n)
+      error = true;
+    else
+      count += n;
+  }
 private:
-  FILE* file;
+  static const size_t block = 16 * FPZIP_BLOCK_SIZE;
+
+  fpzip_write_func func;
+  void* ctx;
   size_t count;
+  std::vector<uchar> buffer;
 };
-#endif
 
 // memory writer for compressed data
 class RCmemencoder : public RCencoder {
 public:
-  RCmemencoder(void* buffer, size_t size) : RCencoder(), ptr((uchar*)buffer), begin(ptr), end(ptr + size) {}
-  void putbyte(uint byte)
+  RCmemencoder(void* buffer, size_t size) : RCencoder() { open(buffer, size); }
+  // start encoding another stream into the given buffer
+  void open(void* buffer, size_t size)
   {
-    if (ptr == end) {
-      error = true;
-      fpzip_errno = fpzipErrorBufferOverflow;
-    }
-    else
-      *ptr++ = (uchar)byte;
+    restart();
+    begin = ptr = static_cast<uchar*>(buffer);
+    end = begin + size;
   }
   size_t bytes() const { return ptr - begin; }
+protected:
+  void overflow(const void*, size_t)
+  {
+    error = true;
+  }
+private:
+  uchar* begin;
+};
+
+// growable memory writer for compressed data
+class RCdynencoder : public RCencoder {
+public:
+  RCdynencoder(size_t size = FPZIP_BLOCK_SIZE) : RCencoder(), buffer(static_cast<uchar*>(malloc(size)))
+  {
+    ptr = buffer;
+    end = buffer ? buffer + size : 0;
+  }
+  ~RCdynencoder() { free(buffer); }
+  size_t bytes() const { return ptr - buffer; }
+  const uchar* data() const { return buffer; }
+  // discard contents but keep buffer for encoding another stream
+  void rewind()
+  {
+    restart();
+    ptr = buffer;
+  }
+  // transfer ownership of the buffer to the caller
+  void* release()
+  {
+    void* p = buffer;
+    buffer = ptr = end = 0;
+    return p;
+  }
+protected:
+  void overflow(const void* data, size_t n)
+  {
+    if (grow(n)) {
+      memcpy(ptr, data, n);
+      ptr += n;
+    }
+  }
 private:
-  uchar* ptr;
-  const uchar* const begin;
-  const uchar* const end;
+  // make room for at least n more bytes
+  bool grow(size_t n)
+  {
+    size_t size = ptr - buffer;
+    size_t c = 2 * (end - buffer) + n;
+    uchar* p = static_cast<uchar*>(realloc(buffer, c));
+    if (!p) {
+      error = true;
+      return false;
+    }
+    buffer = p;
+    ptr = p + size;
+    end = p + c;
+    return true;
+  }
+
+  uchar* buffer;
 };
 
 #endif
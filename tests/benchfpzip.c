@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "fpzip.h"
+
+/* benchmark configuration */
+typedef struct {
+  int type;      /* scalar type */
+  int nx;        /* number of x samples */
+  int ny;        /* number of y samples */
+  int nz;        /* number of z samples */
+  int prec;      /* number of bits of precision */
+  int lanes;     /* number of entropy coder lanes */
+  int coder;     /* entropy coder */
+  int model;     /* probability model */
+  int bypass;    /* store low bits of residuals uncoded? */
+  int predictor; /* predictor (Lorenzo or adaptive) */
+  int threads;   /* number of threads (zero = default) */
+  int repeats;   /* number of timed repetitions */
+} config;
+
+/* pseudo-random number in [-1, 1] */
+static double
+uniform(unsigned int* seed)
+{
+  *seed = 1103515245u * *seed + 12345u;
+  return (double)(*seed >> 8) / (double)(1u << 23) - 1;
+}
+
+/* generate a smooth field with a small amount of noise */
+static void*
+generate(int type, int nx, int ny, int nz)
+{
+  size_t n = (size_t)nx * ny * nz;
+  void* field = malloc(n * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double)));
+  unsigned int seed = 1;
+  double v = 0;
+  size_t i;
+  int x, y, z;
+  for (z = 0, i = 0; z < nz; z++)
+    for (y = 0; y < ny; y++)
+      for (x = 0; x < nx; x++, i++) {
+        double u = (double)x / nx, w = (double)y / ny, t = (double)z / nz;
+        v = 0.999 * v + 1e-3 * uniform(&seed);
+        v = u * (1 - w) + w * t * t - u * t + 0.1 * v;
+        if (type == FPZIP_TYPE_FLOAT)
+          ((float*)field)[i] = (float)v;
+        else
+          ((double*)field)[i] = v;
+      }
+  return field;
+}
+
+/* current time in seconds: wall-clock time when built with OpenMP, as
+   multithreaded compression consumes more processor than elapsed time */
+static double
+now(void)
+{
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* compress once, then time repeated decompression */
+static int
+benchmark(const config* c, const void* field)
+{
+  static const char* const model[] = { "adaptive", "static", "context" };
+  size_t size = (size_t)c->nx * c->ny * c->nz * (c->type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+  size_t bufbytes = 1024 + size;
+  void* buffer = malloc(bufbytes);
+  void* copy = malloc(size);
+  double ctime, dtime = 0;
+  size_t bytes;
+  double start;
+  int i;
+  FPZ* fpz;
+
+  /* compress */
+  start = now();
+  fpz = fpzip_write_to_buffer(buffer, bufbytes);
+  fpz->type = c->type;
+  fpz->prec = c->prec;
+  fpz->nx = c->nx;
+  fpz->ny = c->ny;
+  fpz->nz = c->nz;
+  fpz->lanes = c->lanes;
+  fpz->coder = c->coder;
+  fpz->model = c->model;
+  fpz->bypass = c->bypass;
+  fpz->predictor = c->predictor;
+  fpz->threads = c->threads;
+  bytes = fpzip_write_header(fpz) ? fpzip_write(fpz, field) : 0;
+  fpzip_write_close(fpz);
+  ctime = now() - start;
+  if (!bytes) {
+    fprintf(stderr, "compression failed: %s\n", fpzip_errstr[fpzip_errno]);
+    return 0;
+  }
+
+  /* decompress */
+  for (i = 0; i < c->repeats; i++) {
+    start = now();
+    fpz = fpzip_read_from_buffer(buffer);
+    if (!fpzip_read_header(fpz) || !fpzip_read(fpz, copy)) {
+      fprintf(stderr, "decompression failed: %s\n", fpzip_errstr[fpzip_errno]);
+      return 0;
+    }
+    fpzip_read_close(fpz);
+    dtime += now() - start;
+  }
+  dtime /= c->repeats;
+
+  printf("%-6s %4d %-5s %-8s %-3s %-9s %5d %8.3f %8.1f %8.1f\n",
+    c->type == FPZIP_TYPE_FLOAT ? "float" : "double", c->prec ? c->prec : (c->type == FPZIP_TYPE_FLOAT ? 32 : 64),
+    c->coder == FPZIP_CODER_RANGE ? "range" : "rans", model[c->model], c->bypass ? "yes" : "no",
+    c->predictor == FPZIP_PREDICTOR_LORENZO ? "lorenzo" : "adaptive", c->lanes,
+    (double)size / bytes, size / (1e6 * ctime), size / (1e6 * dtime));
+
+  free(copy);
+  free(buffer);
+
+  return 1;
+}
+
+int main(int argc, char* argv[])
+{
+  static const int lanes[] = { 1, 2, 4, 8 };
+  config c;
+  int n = argc > 1 ? atoi(argv[1]) : 128;
+  int type, coder, model, bypass, predictor, i;
+
+  c.nx = c.ny = c.nz = n;
+  c.repeats = argc > 2 ? atoi(argv[2]) : 3;
+  c.threads = argc > 3 ? atoi(argv[3]) : 0;
+  if (n <= 0 || c.repeats <= 0 || c.threads < 0) {
+    fprintf(stderr, "Usage: benchfpzip [size [repetitions [threads]]]\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("%s\n", fpzip_version_string);
+  printf("%d x %d x %d array; %d threads (0 = default); throughput in MB/s of uncompressed data\n", n, n, n, c.threads);
+  printf("type   prec coder model    raw predictor lanes    ratio compress decompress\n");
+  for (type = FPZIP_TYPE_FLOAT; type <= FPZIP_TYPE_DOUBLE; type++) {
+    void* field = generate(type, c.nx, c.ny, c.nz);
+    c.type = type;
+    c.prec = 0;
+    for (coder = FPZIP_CODER_RANGE; coder <= FPZIP_CODER_RANS; coder++) {
+      c.coder = coder;
+      for (model = FPZIP_MODEL_ADAPTIVE; model <= FPZIP_MODEL_CONTEXT; model++) {
+        c.model = model;
+        for (bypass = 0; bypass <= 1; bypass++) {
+          c.bypass = bypass;
+          for (predictor = FPZIP_PREDICTOR_LORENZO; predictor <= FPZIP_PREDICTOR_ADAPTIVE; predictor++) {
+            c.predictor = predictor;
+            for (i = 0; i < (int)(sizeof(lanes) / sizeof(lanes[0])); i++) {
+              c.lanes = lanes[i];
+              if (!benchmark(&c, field))
+                return EXIT_FAILURE;
+            }
+          }
+        }
+      }
+    }
+    free(field);
+  }
+
+  return EXIT_SUCCESS;
+}
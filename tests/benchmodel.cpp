@@ -0,0 +1,92 @@
+// micro-benchmark of symbol decoding using adaptive probability models
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include "rcqsmodel.h"
+#include "rclookupmodel.h"
+
+// pseudo-random number in [0, 1)
+static double
+uniform(uint& seed)
+{
+  seed = 1103515245u * seed + 12345u;
+  return (double)(seed >> 8) / (double)(1u << 24);
+}
+
+// seconds of processor time elapsed since start
+static double
+elapsed(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// generate symbols centered on the middle symbol with geometrically
+// decaying probabilities, as for prediction residuals, along with the
+// cumulative frequency within each symbol's range seen by the decoder
+static void
+generate(std::vector<uint>& symbol, std::vector<uint>& cumulative, uint symbols, double spread)
+{
+  RCqsmodel model(true, symbols);
+  uint seed = 1;
+  int bias = symbols / 2;
+  for (size_t i = 0; i < symbol.size(); i++) {
+    int d = (int)(-spread * std::log(1 - uniform(seed)));
+    if (uniform(seed) < 0.5)
+      d = -d;
+    d += bias;
+    uint s = d < 0 ? 0 : d >= (int)symbols ? symbols - 1 : d;
+    uint l, r;
+    model.encode(s, l, r);
+    symbol[i] = s;
+    cumulative[i] = l + (uint)(uniform(seed) * r);
+  }
+}
+
+// decode all symbols and return throughput in millions of symbols per second
+static double
+benchmark(RCmodel* model, const std::vector<uint>& symbol, const std::vector<uint>& cumulative)
+{
+  bool valid = true;
+  clock_t start = clock();
+  for (size_t i = 0; i < symbol.size(); i++) {
+    uint l = cumulative[i], r;
+    if (model->decode(l, r) != symbol[i])
+      valid = false;
+  }
+  double time = elapsed(start);
+  delete model;
+  return valid ? symbol.size() / (1e6 * time) : 0;
+}
+
+int main(int argc, char* argv[])
+{
+  // alphabet sizes of wide float, wide double, and narrow 8-bit residuals
+  static const uint symbols[] = { 65, 129, 511 };
+  static const double spread[] = { 1, 4, 16 };
+  size_t n = argc > 1 ? (size_t)atol(argv[1]) : 1u << 22;
+  if (!n) {
+    fprintf(stderr, "Usage: benchmodel [count]\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<uint> symbol(n);
+  std::vector<uint> cumulative(n);
+  printf("%lu symbols; throughput in millions of decoded symbols per second\n", (ulong)n);
+  printf("symbols spread   search   lookup speedup\n");
+  for (uint i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++)
+    for (uint j = 0; j < sizeof(spread) / sizeof(spread[0]); j++) {
+      generate(symbol, cumulative, symbols[i], spread[j]);
+      double search = benchmark(new RCqsmodel(false, symbols[i]), symbol, cumulative);
+      double lookup = benchmark(new RClookupmodel(symbols[i]), symbol, cumulative);
+      if (!search || !lookup) {
+        fprintf(stderr, "decoded symbols do not match\n");
+        return EXIT_FAILURE;
+      }
+      printf("%7u %6.0f %8.1f %8.1f %7.2f\n", symbols[i], spread[j], search, lookup, lookup / search);
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -1,3 +1,9 @@
+#if defined(__unix__) || defined(__APPLE__)
+/* expose anonymous memory mappings also under strict ISO C */
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+#include <sys/mman.h>
+#endif
 #include <limits.h>
 #include <math.h>
 #include <stdio.h>
@@ -351,6 +357,1399 @@ test_double(int nx, int ny, int nz)
   return success;
 }
 
+/* compress array in chunks using one or more threads */
+static size_t
+compress_chunked(const void* field, void* buffer, size_t bufbytes, int type, int nx, int ny, int nz, int cx, int cy, int cz, int prec, int threads)
+{
+  size_t outbytes;
+  FPZ* fpz = fpzip_write_to_buffer(buffer, bufbytes);
+  fpz->type = type;
+  fpz->prec = prec;
+  fpz->nx = nx;
+  fpz->ny = ny;
+  fpz->nz = nz;
+  fpz->nf = 1;
+  fpz->cx = cx;
+  fpz->cy = cy;
+  fpz->cz = cz;
+  fpz->threads = threads;
+  outbytes = compress(fpz, field);
+  fpzip_write_close(fpz);
+  return outbytes;
+}
+
+/* test that pipelined compression of unchunked arrays matches serial output */
+static int
+test_pipelined(int nx, int ny, int nz)
+{
+  int success = 1;
+  int status;
+  int type, prec;
+  size_t inbytes = nx * ny * nz * sizeof(double);
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes;
+  void* buffer = malloc(bufbytes);
+  void* parbuffer = malloc(bufbytes);
+  float* ffield = float_field(nx, ny, nz, 0);
+  double* dfield = double_field(nx, ny, nz, 0);
+  char name[0x100];
+
+  for (type = FPZIP_TYPE_FLOAT; type <= FPZIP_TYPE_DOUBLE; type++) {
+    const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+    const void* field = (type == FPZIP_TYPE_FLOAT ? (const void*)ffield : (const void*)dfield);
+    for (prec = 0; prec <= 16; prec += 16) {
+      outbytes = compress_chunked(field, buffer, bufbytes, type, nx, ny, nz, 0, 0, 0, prec, 1);
+      status = (outbytes != 0 && compress_chunked(field, parbuffer, bufbytes, type, nx, ny, nz, 0, 0, 0, prec, 2) == outbytes && !memcmp(buffer, parbuffer, outbytes));
+      sprintf(name, "test.%s.pipelined.prec%d", tname, prec);
+      success &= test(name, status);
+    }
+  }
+
+  free(dfield);
+  free(ffield);
+  free(parbuffer);
+  free(buffer);
+
+  return success;
+}
+
+/* perform chunked compression, decompression, and validation of 3D array */
+static int
+test_chunked_array(const void* field, int type, int nx, int ny, int nz, int cx, int cy, int cz, int prec, unsigned int expected_checksum)
+{
+  int success = 1;
+  int status;
+  unsigned int actual_checksum;
+  const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+  size_t inbytes = nx * ny * nz * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes = 0;
+  void* buffer = malloc(bufbytes);
+  void* parbuffer = malloc(bufbytes);
+  void* copy = malloc(inbytes);
+  char name[0x100];
+
+  /* compress serially and in parallel */
+  outbytes = compress_chunked(field, buffer, bufbytes, type, nx, ny, nz, cx, cy, cz, prec, 1);
+  status = (0 < outbytes && outbytes <= bufbytes);
+  sprintf(name, "test.%s.chunk%dx%dx%d.prec%d.compress", tname, cx, cy, cz, prec);
+  success &= test(name, status);
+
+  if (success) {
+    /* test that output does not depend on number of threads */
+    status = (compress_chunked(field, parbuffer, bufbytes, type, nx, ny, nz, cx, cy, cz, prec, 4) == outbytes && !memcmp(buffer, parbuffer, outbytes));
+    sprintf(name, "test.%s.chunk%dx%dx%d.prec%d.threads", tname, cx, cy, cz, prec);
+    success &= test(name, status);
+
+    /* test checksum */
+    actual_checksum = checksum(buffer, outbytes);
+    status = (actual_checksum == expected_checksum);
+    if (!status)
+      fprintf(stderr, "actual checksum %#010x does not match expected checksum %#010x\n", actual_checksum, expected_checksum);
+    sprintf(name, "test.%s.chunk%dx%dx%d.prec%d.checksum", tname, cx, cy, cz, prec);
+    success &= test(name, status);
+
+    if (success) {
+      /* decompress in parallel */
+      FPZ* fpz = fpzip_read_from_buffer(buffer);
+      fpz->threads = 4;
+      status = decompress(fpz, copy, inbytes);
+      fpzip_read_close(fpz);
+      sprintf(name, "test.%s.chunk%dx%dx%d.prec%d.decompress", tname, cx, cy, cz, prec);
+      success &= test(name, status);
+
+      if (success && !prec) {
+        /* validate */
+        status = !memcmp(field, copy, inbytes);
+        sprintf(name, "test.%s.chunk%dx%dx%d.prec%d.validate", tname, cx, cy, cz, prec);
+        success &= test(name, status);
+      }
+    }
+  }
+
+  free(copy);
+  free(parbuffer);
+  free(buffer);
+
+  return success;
+}
+
+/* chunked tests */
+static int
+test_chunked(int nx, int ny, int nz)
+{
+  int success = 1;
+  const unsigned int cksum[][2][2] = {
+    { /* FPZIP_FP_FAST */
+      { 0xb4c529abu, 0xb1ea7012u }, /* float: slabs, bricks */
+      { 0xbb10db29u, 0xd705fbcbu }, /* double: slabs, bricks */
+    },
+    { /* FPZIP_FP_SAFE */
+      { 0x416d0035u, 0x54630379u }, /* float: slabs, bricks */
+      { 0x307142d2u, 0x3d390ac8u }, /* double: slabs, bricks */
+    },
+    { /* FPZIP_FP_EMUL */
+      { 0x379706b8u, 0x1253a406u }, /* float: slabs, bricks */
+      { 0x30cadd0fu, 0x584e37f4u }, /* double: slabs, bricks */
+    },
+    { /* FPZIP_FP_INT */
+      { 0xb27af948u, 0xe3c50747u }, /* float: slabs, bricks */
+      { 0xd51976c1u, 0xe285bca2u }, /* double: slabs, bricks */
+    },
+  };
+  float* ffield = float_field(nx, ny, nz, 0);
+  double* dfield = double_field(nx, ny, nz, 0);
+  success &= test_chunked_array(ffield, FPZIP_TYPE_FLOAT, nx, ny, nz, 0, 0, 16, 0, cksum[FPZIP_FP - 1][0][0]);
+  success &= test_chunked_array(ffield, FPZIP_TYPE_FLOAT, nx, ny, nz, 32, 20, 16, 0, cksum[FPZIP_FP - 1][0][1]);
+  success &= test_chunked_array(dfield, FPZIP_TYPE_DOUBLE, nx, ny, nz, 0, 0, 16, 0, cksum[FPZIP_FP - 1][1][0]);
+  success &= test_chunked_array(dfield, FPZIP_TYPE_DOUBLE, nx, ny, nz, 32, 20, 16, 32, cksum[FPZIP_FP - 1][1][1]);
+  free(dfield);
+  free(ffield);
+
+  return success;
+}
+
+/* perform multi-field compression and decompression of individual fields */
+static int
+test_fields(int nx, int ny, int nz, int nf)
+{
+  int success = 1;
+  int status;
+  int chunked, k;
+  size_t size = (size_t)nx * ny * nz;
+  size_t bufbytes = 1024 + nf * size * sizeof(float);
+  void* buffer = malloc(bufbytes);
+  float* copy = malloc(size * sizeof(float));
+  float* field = float_field(nx, ny, nz * nf, 0);
+  char name[0x100];
+
+  for (chunked = 0; chunked < 2; chunked++) {
+    /* compress all fields, one chunk per field if chunked */
+    FPZ* fpz = fpzip_write_to_buffer(buffer, bufbytes);
+    fpz->type = FPZIP_TYPE_FLOAT;
+    fpz->prec = 0;
+    fpz->nx = nx;
+    fpz->ny = ny;
+    fpz->nz = nz;
+    fpz->nf = nf;
+    fpz->cz = chunked ? nz : 0;
+    status = (compress(fpz, field) != 0);
+    fpzip_write_close(fpz);
+    sprintf(name, "test.float.fields%d.chunked%d.compress", nf, chunked);
+    success &= test(name, status);
+
+    /* decompress and validate each field separately */
+    for (k = 0; k < nf && success; k++) {
+      fpz = fpzip_read_from_buffer(buffer);
+      memset(copy, 0, size * sizeof(float));
+      status = fpzip_read_header(fpz) && fpzip_read_field(fpz, k, copy) && !memcmp(copy, field + k * size, size * sizeof(float));
+      fpzip_read_close(fpz);
+      sprintf(name, "test.float.fields%d.chunked%d.field%d", nf, chunked, k);
+      success &= test(name, status);
+    }
+  }
+
+  free(field);
+  free(copy);
+  free(buffer);
+
+  return success;
+}
+
+static int
+test_subvolume(int nx, int ny, int nz, int nf)
+{
+  /* chunk dimensions: unchunked, slabs, bricks */
+  static const int chunk[3][3] = { { 0, 0, 0 }, { 0, 0, 4 }, { 16, 12, 4 } };
+  /* boxes: whole array, interior, single sample, unaligned corner */
+  int box[4][6];
+  int success = 1;
+  int status;
+  int c, b, f, x, y, z;
+  size_t size = (size_t)nx * ny * nz;
+  size_t bufbytes = 1024 + nf * size * sizeof(float);
+  void* buffer = malloc(bufbytes);
+  float* copy = malloc(nf * size * sizeof(float));
+  float* field = float_field(nx, ny, nz * nf, 0);
+  char name[0x100];
+
+  box[0][0] = 0;      box[0][1] = 0;      box[0][2] = 0;      box[0][3] = nx;     box[0][4] = ny;     box[0][5] = nz;
+  box[1][0] = nx / 4; box[1][1] = ny / 3; box[1][2] = nz / 2; box[1][3] = nx / 2; box[1][4] = ny / 3; box[1][5] = nz / 4;
+  box[2][0] = nx / 2; box[2][1] = ny / 2; box[2][2] = nz / 2; box[2][3] = 1;      box[2][4] = 1;      box[2][5] = 1;
+  box[3][0] = nx - 5; box[3][1] = ny - 7; box[3][2] = 0;      box[3][3] = 5;      box[3][4] = 7;      box[3][5] = 3;
+
+  for (c = 0; c < 3; c++) {
+    FPZ* fpz = fpzip_write_to_buffer(buffer, bufbytes);
+    fpz->type = FPZIP_TYPE_FLOAT;
+    fpz->prec = 0;
+    fpz->nx = nx;
+    fpz->ny = ny;
+    fpz->nz = nz;
+    fpz->nf = nf;
+    fpz->cx = chunk[c][0];
+    fpz->cy = chunk[c][1];
+    fpz->cz = chunk[c][2];
+    status = (compress(fpz, field) != 0);
+    fpzip_write_close(fpz);
+    sprintf(name, "test.float.subvolume.chunks%d.compress", c);
+    success &= test(name, status);
+
+    /* decompress and validate each box */
+    for (b = 0; b < 4 && success; b++) {
+      const int* v = box[b];
+      float* p = copy;
+      fpz = fpzip_read_from_buffer(buffer);
+      fpz->threads = 4;
+      status = fpzip_read_header(fpz) && fpzip_read_subvolume(fpz, v[0], v[1], v[2], v[3], v[4], v[5], copy);
+      fpzip_read_close(fpz);
+      for (f = 0; f < nf && status; f++)
+        for (z = v[2]; z < v[2] + v[5] && status; z++)
+          for (y = v[1]; y < v[1] + v[4] && status; y++)
+            for (x = v[0]; x < v[0] + v[3] && status; x++)
+              status = !memcmp(p++, field + x + nx * (y + ny * (z + (size_t)nz * f)), sizeof(float));
+      sprintf(name, "test.float.subvolume.chunks%d.box%d", c, b);
+      success &= test(name, status);
+    }
+  }
+
+  /* boxes that exceed the array must be rejected */
+  {
+    FPZ* fpz = fpzip_read_from_buffer(buffer);
+    status = fpzip_read_header(fpz) && !fpzip_read_subvolume(fpz, 1, 0, 0, nx, ny, nz, copy) && fpzip_errno == fpzipErrorBadArgument;
+    fpzip_read_close(fpz);
+    success &= test("test.float.subvolume.invalid", status);
+  }
+
+  free(field);
+  free(copy);
+  free(buffer);
+
+  return success;
+}
+
+/* compress array using given entropy coding options */
+static size_t
+compress_lanes(const void* field, void* buffer, size_t bufbytes, int type, int nx, int ny, int nz, int nf, int cx, int cy, int cz, int prec, int lanes, int coder, int model, int bypass)
+{
+  size_t outbytes;
+  FPZ* fpz = fpzip_write_to_buffer(buffer, bufbytes);
+  fpz->type = type;
+  fpz->prec = prec;
+  fpz->nx = nx;
+  fpz->ny = ny;
+  fpz->nz = nz;
+  fpz->nf = nf;
+  fpz->cx = cx;
+  fpz->cy = cy;
+  fpz->cz = cz;
+  fpz->lanes = lanes;
+  fpz->coder = coder;
+  fpz->model = model;
+  fpz->bypass = bypass;
+  outbytes = compress(fpz, field);
+  fpzip_write_close(fpz);
+  return outbytes;
+}
+
+/* entropy coding options of one test configuration */
+typedef struct {
+  int type, cx, cy, cz, prec, lanes, coder, model, bypass;
+} coding_config;
+
+/* compress multiple fields using given coding options and compare with default coding */
+static int
+test_coding(const char* cname, const coding_config* config, int configs, const unsigned int* cksum, int nx, int ny, int nz)
+{
+  const int nf = 3;
+  int success = 1;
+  int status;
+  int i, k;
+  unsigned int actual_checksum;
+  size_t size = (size_t)nx * ny * nz;
+  size_t inbytes = nf * size * sizeof(double);
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes;
+  void* buffer = malloc(bufbytes);
+  void* refbuffer = malloc(bufbytes);
+  void* copy = malloc(inbytes);
+  void* ref = malloc(inbytes);
+  float* ffield = float_field(nx, ny, nz * nf, 0);
+  double* dfield = double_field(nx, ny, nz * nf, 0);
+  char name[0x100];
+
+  for (i = 0; i < configs; i++) {
+    const coding_config* c = config + i;
+    const char* tname = (c->type == FPZIP_TYPE_FLOAT ? "float" : "double");
+    const void* field = (c->type == FPZIP_TYPE_FLOAT ? (const void*)ffield : (const void*)dfield);
+    size_t bytes = size * (c->type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+    FPZ* fpz;
+
+    /* compress all fields using default (reference) and given coding options */
+    outbytes = compress_lanes(field, buffer, bufbytes, c->type, nx, ny, nz, nf, c->cx, c->cy, c->cz, c->prec, c->lanes, c->coder, c->model, c->bypass);
+    status = (outbytes != 0 && compress_lanes(field, refbuffer, bufbytes, c->type, nx, ny, nz, nf, c->cx, c->cy, c->cz, c->prec, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0) != 0);
+    sprintf(name, "test.%s.%s.config%d.compress", tname, cname, i);
+    success &= test(name, status);
+    if (!status)
+      continue;
+
+    /* test checksum */
+    actual_checksum = checksum(buffer, outbytes);
+    status = (actual_checksum == cksum[i]);
+    if (!status)
+      fprintf(stderr, "actual checksum %#010x does not match expected checksum %#010x\n", actual_checksum, cksum[i]);
+    sprintf(name, "test.%s.%s.config%d.checksum", tname, cname, i);
+    success &= test(name, status);
+
+    /* decompress reference */
+    fpz = fpzip_read_from_buffer(refbuffer);
+    status = fpzip_read_header(fpz) && fpzip_read(fpz, ref);
+    fpzip_read_close(fpz);
+
+    /* decompress, verify coding options, and compare with reference */
+    fpz = fpzip_read_from_buffer(buffer);
+    status = status && fpzip_read_header(fpz) &&
+             (fpz->lanes > 1 ? fpz->lanes : 1) == c->lanes && fpz->coder == c->coder && fpz->model == c->model && fpz->bypass == c->bypass &&
+             fpzip_read(fpz, copy) == outbytes && !memcmp(copy, ref, nf * bytes);
+    fpzip_read_close(fpz);
+    sprintf(name, "test.%s.%s.config%d.decompress", tname, cname, i);
+    success &= test(name, status);
+
+    /* decompress each field separately */
+    for (k = nf - 1; k >= 0 && status; k--) {
+      fpz = fpzip_read_from_buffer(buffer);
+      status = fpzip_read_header(fpz) && fpzip_read_field(fpz, k, copy) && !memcmp(copy, (const char*)ref + k * bytes, bytes);
+      fpzip_read_close(fpz);
+    }
+    sprintf(name, "test.%s.%s.config%d.fields", tname, cname, i);
+    success &= test(name, status);
+  }
+
+  free(dfield);
+  free(ffield);
+  free(ref);
+  free(copy);
+  free(refbuffer);
+  free(buffer);
+
+  return success;
+}
+
+/* perform compression using multiple lanes and compare with one lane */
+static int
+test_lanes(int nx, int ny, int nz)
+{
+  const unsigned int cksum[][4] = {
+    /* float: 4 lanes, 4 lanes + bricks, 16 bits; double: 8 lanes, 4 lanes + slabs, 32 bits */
+    { 0x885976f0u, 0x73960902u, 0x594e7ce5u, 0xd409badfu }, /* FPZIP_FP_FAST */
+    { 0xd4576d28u, 0xa3f5ef89u, 0x4f9cfc54u, 0xdb014d8au }, /* FPZIP_FP_SAFE */
+    { 0xa303ee23u, 0x91fbbbc5u, 0xb278dc61u, 0xaff3dfa3u }, /* FPZIP_FP_EMUL */
+    { 0x7e1ff353u, 0xf8a1b211u, 0xaba1fb17u, 0xc0a489eeu }, /* FPZIP_FP_INT */
+  };
+  const coding_config config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  32, 20, 16, 16, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 8, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0, 16, 32, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+  };
+  return test_coding("lanes", config, sizeof(config) / sizeof(*config), cksum[FPZIP_FP - 1], nx, ny, nz);
+}
+
+/* perform compression using rANS and compare with range coding */
+static int
+test_rans(int nx, int ny, int nz)
+{
+  const unsigned int cksum[][4] = {
+    /* float: 1 lane, 1 lane + bricks, 16 bits; double: 4 lanes, 1 lane + slabs, 32 bits */
+    { 0xc821ca94u, 0x4d5f3b2cu, 0x815d040cu, 0x462171acu }, /* FPZIP_FP_FAST */
+    { 0x095e1262u, 0xccbbbfdau, 0xb1275221u, 0x42478f0fu }, /* FPZIP_FP_SAFE */
+    { 0x57a45c0au, 0x26447063u, 0x4b8a9b4bu, 0x46f0bee3u }, /* FPZIP_FP_EMUL */
+    { 0x8000bd31u, 0x866ad17fu, 0xa11e1f2cu, 0x91fe70efu }, /* FPZIP_FP_INT */
+  };
+  const coding_config config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 1, FPZIP_CODER_RANS, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  32, 20, 16, 16, 1, FPZIP_CODER_RANS, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 4, FPZIP_CODER_RANS, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0, 16, 32, 1, FPZIP_CODER_RANS, FPZIP_MODEL_ADAPTIVE, 0 },
+  };
+  return test_coding("rans", config, sizeof(config) / sizeof(*config), cksum[FPZIP_FP - 1], nx, ny, nz);
+}
+
+/* perform compression using semi-static models and compare with adaptive models */
+static int
+test_static(int nx, int ny, int nz)
+{
+  const unsigned int cksum[][4] = {
+    /* float: range, rANS + 2 lanes + bricks + 16 bits; double: rANS, range + 4 lanes + slabs + 32 bits */
+    { 0xcf767219u, 0x8267d2a4u, 0x398953cdu, 0xaf274fc8u }, /* FPZIP_FP_FAST */
+    { 0xd51669fau, 0x33a2042eu, 0xf88b9dd9u, 0x7271d48cu }, /* FPZIP_FP_SAFE */
+    { 0xa5e5111au, 0xe67219bfu, 0x2ad37002u, 0x97d82015u }, /* FPZIP_FP_EMUL */
+    { 0x5cfea27cu, 0x1774d6bdu, 0x81db6759u, 0x2b09bae5u }, /* FPZIP_FP_INT */
+  };
+  const coding_config config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC, 0 },
+    { FPZIP_TYPE_FLOAT,  32, 20, 16, 16, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 1, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0, 16, 32, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC, 0 },
+  };
+  return test_coding("static", config, sizeof(config) / sizeof(*config), cksum[FPZIP_FP - 1], nx, ny, nz);
+}
+
+/* perform compression using context-selected models and compare with single adaptive models */
+static int
+test_context(int nx, int ny, int nz)
+{
+  const unsigned int cksum[][4] = {
+    /* float: range + 1 lane, rANS + 2 lanes + bricks + 16 bits; double: rANS + 4 lanes, range + 1 lane + slabs + 32 bits */
+    { 0x50122361u, 0x1e81834eu, 0x949f5dc5u, 0x15e0157cu }, /* FPZIP_FP_FAST */
+    { 0x12a40bd6u, 0x01e49cbeu, 0x0ffcd60fu, 0x26c4b2f3u }, /* FPZIP_FP_SAFE */
+    { 0x7088b995u, 0x6d21c525u, 0x030ea251u, 0xc7b93b3bu }, /* FPZIP_FP_EMUL */
+    { 0x1367e5d2u, 0x40277310u, 0x58f10f2fu, 0x0e59fd37u }, /* FPZIP_FP_INT */
+  };
+  const coding_config config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT, 0 },
+    { FPZIP_TYPE_FLOAT,  32, 20, 16, 16, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_CONTEXT, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 4, FPZIP_CODER_RANS,  FPZIP_MODEL_CONTEXT, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0, 16, 32, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT, 0 },
+  };
+  return test_coding("context", config, sizeof(config) / sizeof(*config), cksum[FPZIP_FP - 1], nx, ny, nz);
+}
+
+/* perform compression with raw low residual bits and compare with entropy coded bits */
+static int
+test_bypass(int nx, int ny, int nz)
+{
+  const unsigned int cksum[][4] = {
+    /* float: range + 1 lane, rANS + 2 lanes + bricks + 16 bits + static; double: range + 4 lanes + context, rANS + 1 lane + slabs + 32 bits */
+    { 0xdc9117edu, 0xf2acf039u, 0xf5f9b80au, 0x4369ecfdu }, /* FPZIP_FP_FAST */
+    { 0x8e0d1026u, 0x1cdad4ceu, 0x5d14c886u, 0x89758e11u }, /* FPZIP_FP_SAFE */
+    { 0x5fe447f5u, 0x35ce72adu, 0x51ea9707u, 0x963daed8u }, /* FPZIP_FP_EMUL */
+    { 0xa5199795u, 0x5ec78e15u, 0x08b7dba3u, 0xb50bc618u }, /* FPZIP_FP_INT */
+  };
+  const coding_config config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 1 },
+    { FPZIP_TYPE_FLOAT,  32, 20, 16, 16, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC,   1 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  1 },
+    { FPZIP_TYPE_DOUBLE,  0,  0, 16, 32, 1, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 1 },
+  };
+  return test_coding("bypass", config, sizeof(config) / sizeof(*config), cksum[FPZIP_FP - 1], nx, ny, nz);
+}
+
+static int
+test_path(int nx, int ny, int nz)
+{
+  const char* path = "testfpzip.fpz";
+  int success = 1;
+  int status;
+  size_t size = (size_t)nx * ny * nz;
+  size_t inbytes = size * sizeof(float);
+  size_t outbytes = 0;
+  void* buffer;
+  float* copy = malloc(inbytes);
+  float* field = float_field(nx, ny, nz, 0);
+  FILE* file;
+  FPZ* fpz;
+
+  /* compress to file */
+  file = fopen(path, "wb");
+  status = (file != NULL);
+  if (status) {
+    fpz = fpzip_write_to_file(file);
+    fpz->type = FPZIP_TYPE_FLOAT;
+    fpz->prec = 0;
+    fpz->nx = nx;
+    fpz->ny = ny;
+    fpz->nz = nz;
+    fpz->nf = 1;
+    outbytes = compress(fpz, field);
+    fpzip_write_close(fpz);
+    status = (fclose(file) == 0 && outbytes != 0);
+  }
+  success &= test("test.float.path.compress", status);
+  if (!status) {
+    free(field);
+    free(copy);
+    return success;
+  }
+
+  /* decompress from mapped file and make sure all of it is consumed */
+  fpz = fpzip_read_from_path(path);
+  status = (fpz != NULL);
+  if (status) {
+    status = fpzip_read_header(fpz) && fpzip_read(fpz, copy) == outbytes && !memcmp(copy, field, inbytes);
+    fpzip_read_close(fpz);
+  }
+  success &= test("test.float.path.decompress", status);
+
+  /* decompress buffer of known size followed by unrelated data */
+  buffer = malloc(outbytes + 0x100);
+  file = fopen(path, "rb");
+  status = (file != NULL && fread(buffer, 1, outbytes, file) == outbytes);
+  if (file)
+    fclose(file);
+  if (status) {
+    memset((char*)buffer + outbytes, 0xff, 0x100);
+    fpz = fpzip_read_from_mmap(buffer, outbytes + 0x100);
+    status = fpzip_read_header(fpz) && fpzip_read(fpz, copy) == outbytes && !memcmp(copy, field, inbytes);
+    fpzip_read_close(fpz);
+  }
+  success &= test("test.float.path.buffer", status);
+  free(buffer);
+
+  /* attempt to open nonexistent file */
+  remove(path);
+  fpz = fpzip_read_from_path(path);
+  status = (fpz == NULL && fpzip_errno == fpzipErrorReadStream);
+  success &= test("test.float.path.missing", status);
+
+  free(field);
+  free(copy);
+
+  return success;
+}
+
+/* output sink for fpzip_write_to_callback */
+typedef struct {
+  unsigned char* data; /* storage */
+  size_t size;         /* bytes of storage */
+  size_t bytes;        /* bytes written */
+} sink;
+
+static size_t
+write_sink(void* ctx, const void* data, size_t size)
+{
+  sink* s = ctx;
+  if (size > s->size - s->bytes)
+    return 0;
+  memcpy(s->data + s->bytes, data, size);
+  s->bytes += size;
+  return size;
+}
+
+static FPZ*
+setup_output(FPZ* fpz, int type, int nx, int ny, int nz, int nf)
+{
+  fpz->type = type;
+  fpz->prec = 0;
+  fpz->nx = nx;
+  fpz->ny = ny;
+  fpz->nz = nz;
+  fpz->nf = nf;
+  return fpz;
+}
+
+static int
+test_callback(int nx, int ny, int nz)
+{
+  const int nf = 2;
+  int success = 1;
+  int status;
+  size_t size = (size_t)nx * ny * nz * nf;
+  size_t inbytes = size * sizeof(double);
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes;
+  size_t bytes;
+  void* buffer = malloc(bufbytes);
+  void* copy = malloc(inbytes);
+  void* memory;
+  double* field = double_field(nx, ny, nz * nf, 0);
+  sink s;
+  FPZ* fpz;
+
+  /* compress to buffer (reference) */
+  fpz = setup_output(fpzip_write_to_buffer(buffer, bufbytes), FPZIP_TYPE_DOUBLE, nx, ny, nz, nf);
+  outbytes = compress(fpz, field);
+  fpzip_write_close(fpz);
+  success &= test("test.double.callback.reference", outbytes != 0);
+  if (!outbytes) {
+    free(field);
+    free(copy);
+    free(buffer);
+    return success;
+  }
+
+  /* compress via callback and compare with reference */
+  s.size = outbytes;
+  s.data = malloc(s.size);
+  s.bytes = 0;
+  fpz = setup_output(fpzip_write_to_callback(write_sink, &s), FPZIP_TYPE_DOUBLE, nx, ny, nz, nf);
+  bytes = compress(fpz, field);
+  fpzip_write_close(fpz);
+  status = (bytes == outbytes && s.bytes == outbytes && !memcmp(s.data, buffer, outbytes));
+  success &= test("test.double.callback.compress", status);
+
+  /* make sure callback errors are reported */
+  s.size = outbytes / 2;
+  s.bytes = 0;
+  fpz = setup_output(fpzip_write_to_callback(write_sink, &s), FPZIP_TYPE_DOUBLE, nx, ny, nz, nf);
+  status = (fpzip_write_header(fpz) && !fpzip_write(fpz, field) && fpzip_errno == fpzipErrorWriteStream);
+  fpzip_write_close(fpz);
+  success &= test("test.double.callback.error", status);
+  free(s.data);
+
+  /* compress to growable buffer and compare with reference */
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_DOUBLE, nx, ny, nz, nf);
+  bytes = compress(fpz, field);
+  memory = fpzip_write_close_memory(fpz, &size);
+  status = (memory != NULL && bytes == outbytes && size == outbytes && !memcmp(memory, buffer, outbytes));
+  success &= test("test.double.memory.compress", status);
+
+  /* decompress growable buffer */
+  if (status) {
+    fpz = fpzip_read_from_mmap(memory, size);
+    status = decompress(fpz, copy, inbytes) && !memcmp(copy, field, inbytes);
+    fpzip_read_close(fpz);
+  }
+  success &= test("test.double.memory.decompress", status);
+  free(memory);
+
+  free(field);
+  free(copy);
+  free(buffer);
+
+  return success;
+}
+
+static int
+test_bound(int nx, int ny, int nz)
+{
+  const struct {
+    int type, cx, cy, cz, prec, lanes, coder, model, bypass;
+  } config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  8, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC,   0 },
+    { FPZIP_TYPE_FLOAT,   0,  0,  0, 20, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  16, 16,  0,  0, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC,   1 },
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 3, FPZIP_CODER_RANS,  FPZIP_MODEL_CONTEXT,  0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  8, 48, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 2, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC,   1 },
+    { FPZIP_TYPE_DOUBLE, 32, 32, 32,  0, 4, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 1 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0, 16, 1, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC,   0 },
+  };
+  const int nf = 2;
+  const int configs = (int)(sizeof(config) / sizeof(config[0]));
+  int success = 1;
+  int status;
+  int i;
+  unsigned int seed = 1;
+  size_t j;
+  size_t size = (size_t)nx * ny * nz * nf;
+  size_t inbytes = size * sizeof(double);
+  size_t bound;
+  size_t outbytes;
+  unsigned char* field = malloc(inbytes);
+  void* buffer;
+  char name[0x100];
+  FPZ* fpz;
+
+  /* fill arrays with random bits, which are incompressible */
+  for (j = 0; j < inbytes; j++) {
+    seed = 1103515245 * seed + 12345;
+    field[j] = (unsigned char)(seed >> 16);
+  }
+
+  for (i = 0; i < configs; i++) {
+    const int type = config[i].type;
+    const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+
+    /* compute bound */
+    fpz = setup_output(fpzip_write_to_buffer(NULL, 0), type, nx, ny, nz, nf);
+    fpz->cx = config[i].cx;
+    fpz->cy = config[i].cy;
+    fpz->cz = config[i].cz;
+    fpz->prec = config[i].prec;
+    fpz->lanes = config[i].lanes;
+    fpz->coder = config[i].coder;
+    fpz->model = config[i].model;
+    fpz->bypass = config[i].bypass;
+    bound = fpzip_compress_bound(fpz);
+    fpzip_write_close(fpz);
+
+    /* compress into buffer of exactly that size */
+    buffer = malloc(bound);
+    outbytes = bound ? compress_lanes(field, buffer, bound, type, nx, ny, nz, nf, config[i].cx, config[i].cy, config[i].cz, config[i].prec, config[i].lanes, config[i].coder, config[i].model, config[i].bypass) : 0;
+    free(buffer);
+    status = (outbytes != 0 && outbytes <= bound);
+    sprintf(name, "test.%s.bound.config%d", tname, i);
+    success &= test(name, status);
+  }
+
+  /* make sure invalid precision is rejected */
+  fpz = setup_output(fpzip_write_to_buffer(NULL, 0), FPZIP_TYPE_DOUBLE, nx, ny, nz, nf);
+  fpz->prec = 33;
+  status = (fpzip_compress_bound(fpz) == 0 && fpzip_errno == fpzipErrorBadPrecision);
+  fpzip_write_close(fpz);
+  success &= test("test.double.bound.precision", status);
+
+  free(field);
+
+  return success;
+}
+
+/* compress array a few slices at a time and compare with one-shot compression */
+static int
+test_slices(int nx, int ny, int nz)
+{
+  const struct {
+    int type, prec, lanes, coder, model, bypass;
+  } config[] = {
+    { FPZIP_TYPE_FLOAT,   0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  20, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,   0, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_CONTEXT,  1 },
+    { FPZIP_TYPE_DOUBLE,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  0 },
+    { FPZIP_TYPE_DOUBLE, 48, 1, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0, 3, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 1 },
+  };
+  /* numbers of slices per call, some of which span fields */
+  const int step[] = { 1, 0, 7, 13, 40 };
+  const int nf = 3;
+  const int configs = (int)(sizeof(config) / sizeof(config[0]));
+  const int steps = (int)(sizeof(step) / sizeof(step[0]));
+  int success = 1;
+  int status;
+  int i, j, k;
+  size_t size = (size_t)nx * ny * nz * nf;
+  size_t inbytes = size * sizeof(double);
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes;
+  size_t bytes;
+  void* buffer = malloc(bufbytes);
+  void* memory;
+  float* ffield = float_field(nx, ny, nz * nf, 0);
+  double* dfield = double_field(nx, ny, nz * nf, 0);
+  char name[0x100];
+  FPZ* fpz;
+
+  for (i = 0; i < configs; i++) {
+    const int type = config[i].type;
+    const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+    const void* field = (type == FPZIP_TYPE_FLOAT ? (const void*)ffield : (const void*)dfield);
+    const size_t slice = (size_t)nx * ny * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+
+    /* compress whole array (reference) */
+    outbytes = compress_lanes(field, buffer, bufbytes, type, nx, ny, nz, nf, 0, 0, 0, config[i].prec, config[i].lanes, config[i].coder, config[i].model, config[i].bypass);
+
+    /* compress array a varying number of slices at a time */
+    fpz = setup_output(fpzip_write_to_memory(), type, nx, ny, nz, nf);
+    fpz->prec = config[i].prec;
+    fpz->lanes = config[i].lanes;
+    fpz->coder = config[i].coder;
+    fpz->model = config[i].model;
+    fpz->bypass = config[i].bypass;
+    status = fpzip_write_header(fpz) && fpzip_write_begin(fpz);
+    for (j = k = 0; status && k < nz * nf; j = (j + 1) % steps) {
+      int n = (step[j] < nz * nf - k ? step[j] : nz * nf - k);
+      status = fpzip_write_slices(fpz, (const char*)field + k * slice, n);
+      k += n;
+    }
+    bytes = status ? fpzip_write_end(fpz) : 0;
+    memory = fpzip_write_close_memory(fpz, &size);
+    status = (outbytes != 0 && memory != NULL && bytes == outbytes && size == outbytes && !memcmp(memory, buffer, outbytes));
+    free(memory);
+    sprintf(name, "test.%s.slices.config%d", tname, i);
+    success &= test(name, status);
+  }
+
+  /* make sure semi-static models and chunked streams are rejected */
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_FLOAT, nx, ny, nz, nf);
+  fpz->model = FPZIP_MODEL_STATIC;
+  status = (fpzip_write_header(fpz) && !fpzip_write_begin(fpz) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_write_close(fpz);
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_FLOAT, nx, ny, nz, nf);
+  fpz->cz = 1;
+  status &= (fpzip_write_header(fpz) && !fpzip_write_begin(fpz) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_write_close(fpz);
+  success &= test("test.float.slices.unsupported", status);
+
+  /* make sure too many or too few slices are rejected */
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_FLOAT, nx, ny, nz, 1);
+  status = (fpzip_write_header(fpz) && fpzip_write_begin(fpz) && fpzip_write_slices(fpz, ffield, nz - 1));
+  status &= (!fpzip_write_slices(fpz, ffield, 2) && fpzip_errno == fpzipErrorBadArgument);
+  status &= (!fpzip_write_end(fpz) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_write_close(fpz);
+  success &= test("test.float.slices.count", status);
+
+  /* one-shot compression must not interleave with slices of another array */
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_FLOAT, nx, ny, nz, 1);
+  status = (fpzip_write_header(fpz) && fpzip_write_begin(fpz) && fpzip_write_slices(fpz, ffield, 1));
+  status &= (!fpzip_write(fpz, ffield) && fpzip_errno == fpzipErrorBadArgument);
+  status &= (fpzip_write_slices(fpz, ffield + (size_t)nx * ny, nz - 1) && fpzip_write_end(fpz));
+  fpzip_write_close(fpz);
+  success &= test("test.float.slices.oneshot", status);
+
+  free(ffield);
+  free(dfield);
+  free(buffer);
+
+  return success;
+}
+
+/* decompress array a few slices at a time and compare with one-shot decompression */
+static int
+test_read_slices(int nx, int ny, int nz)
+{
+  const struct {
+    int type, prec, lanes, coder, model, bypass;
+  } config[] = {
+    { FPZIP_TYPE_FLOAT,   0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  16, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC,   0 },
+    { FPZIP_TYPE_FLOAT,   0, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_CONTEXT,  1 },
+    { FPZIP_TYPE_DOUBLE,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  0 },
+    { FPZIP_TYPE_DOUBLE, 40, 4, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC,   0 },
+    { FPZIP_TYPE_DOUBLE,  0, 3, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 1 },
+  };
+  /* numbers of slices per call, some of which span fields */
+  const int step[] = { 2, 0, 9, 1, 40 };
+  const int nf = 3;
+  const int configs = (int)(sizeof(config) / sizeof(config[0]));
+  const int steps = (int)(sizeof(step) / sizeof(step[0]));
+  int success = 1;
+  int status;
+  int i, j, k;
+  size_t size = (size_t)nx * ny * nz * nf;
+  size_t inbytes = size * sizeof(double);
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes;
+  size_t bytes;
+  void* buffer = malloc(bufbytes);
+  void* copy = malloc(inbytes);
+  void* slices = malloc(inbytes);
+  float* ffield = float_field(nx, ny, nz * nf, 0);
+  double* dfield = double_field(nx, ny, nz * nf, 0);
+  char name[0x100];
+  FPZ* fpz;
+
+  for (i = 0; i < configs; i++) {
+    const int type = config[i].type;
+    const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+    const void* field = (type == FPZIP_TYPE_FLOAT ? (const void*)ffield : (const void*)dfield);
+    const size_t slice = (size_t)nx * ny * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+
+    /* compress and decompress whole array (reference) */
+    outbytes = compress_lanes(field, buffer, bufbytes, type, nx, ny, nz, nf, 0, 0, 0, config[i].prec, config[i].lanes, config[i].coder, config[i].model, config[i].bypass);
+    fpz = fpzip_read_from_mmap(buffer, outbytes);
+    status = (outbytes != 0 && decompress(fpz, copy, (size_t)nz * nf * slice));
+    fpzip_read_close(fpz);
+
+    /* decompress array a varying number of slices at a time */
+    fpz = fpzip_read_from_mmap(buffer, outbytes);
+    status = status && fpzip_read_header(fpz);
+    for (j = k = 0, bytes = 0; status && k < nz * nf; j = (j + 1) % steps) {
+      int n = (step[j] < nz * nf - k ? step[j] : nz * nf - k);
+      bytes = fpzip_read_slices(fpz, (char*)slices + k * slice, n);
+      status = (bytes != 0);
+      k += n;
+    }
+    status = status && (bytes == outbytes && !memcmp(slices, copy, (size_t)nz * nf * slice));
+    fpzip_read_close(fpz);
+    sprintf(name, "test.%s.read_slices.config%d", tname, i);
+    success &= test(name, status);
+  }
+
+  /* make sure chunked streams are rejected */
+  outbytes = compress_lanes(ffield, buffer, bufbytes, FPZIP_TYPE_FLOAT, nx, ny, nz, nf, 0, 0, 1, 0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0);
+  fpz = fpzip_read_from_mmap(buffer, outbytes);
+  status = (outbytes != 0 && fpzip_read_header(fpz) && !fpzip_read_slices(fpz, slices, 1) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_read_close(fpz);
+  success &= test("test.float.read_slices.unsupported", status);
+
+  /* make sure reading past the last slice is rejected */
+  outbytes = compress_lanes(ffield, buffer, bufbytes, FPZIP_TYPE_FLOAT, nx, ny, nz, 1, 0, 0, 0, 0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0);
+  fpz = fpzip_read_from_mmap(buffer, outbytes);
+  status = (outbytes != 0 && fpzip_read_header(fpz) && fpzip_read_slices(fpz, slices, nz - 1));
+  status &= (!fpzip_read_slices(fpz, slices, 2) && fpzip_errno == fpzipErrorBadArgument);
+  status &= (fpzip_read_slices(fpz, slices, 1) == outbytes);
+  status &= (!fpzip_read_slices(fpz, slices, 0) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_read_close(fpz);
+  success &= test("test.float.read_slices.count", status);
+
+  /* one-shot decompression must not interleave with slices, whether in the
+     middle of a field or between fields */
+  outbytes = compress_lanes(ffield, buffer, bufbytes, FPZIP_TYPE_FLOAT, nx, ny, nz, 2, 0, 0, 0, 0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0);
+  fpz = fpzip_read_from_mmap(buffer, outbytes);
+  status = (outbytes != 0 && fpzip_read_header(fpz));
+  for (j = 0; status && j < 2; j++) {
+    status = fpzip_read_slices(fpz, slices, j ? nz - 1 : 1) != 0;
+    status &= (!fpzip_read(fpz, copy) && fpzip_errno == fpzipErrorBadArgument);
+    status &= (!fpzip_read_field(fpz, 1, copy) && fpzip_errno == fpzipErrorBadArgument);
+    status &= (!fpzip_read_subvolume(fpz, 0, 0, 0, nx, ny, 1, copy) && fpzip_errno == fpzipErrorBadArgument);
+  }
+  status = status && fpzip_read_slices(fpz, slices, nz) == outbytes;
+  fpzip_read_close(fpz);
+  success &= test("test.float.read_slices.oneshot", status);
+
+  free(ffield);
+  free(dfield);
+  free(slices);
+  free(copy);
+  free(buffer);
+
+  return success;
+}
+
+/* compress and decompress streams on several threads at once, provoking
+   different errors, and make sure each thread sees only its own */
+static int
+test_threads(int nx, int ny, int nz)
+{
+  const int n = 48;
+  int success = 1;
+  int i;
+  size_t size = (size_t)nx * ny * nz;
+  size_t inbytes = size * sizeof(float);
+  size_t bufbytes = 1024 + inbytes;
+  float* field = float_field(nx, ny, nz, 0);
+  int* status = malloc(n * sizeof(int));
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(4)
+#endif
+  for (i = 0; i < n; i++) {
+    void* buffer = malloc(bufbytes);
+    void* copy = malloc(inbytes);
+    size_t outbytes;
+    FPZ* fpz;
+    switch (i % 3) {
+      case 0:
+        /* compress and decompress without error */
+        fpz = setup_output(fpzip_write_to_buffer(buffer, bufbytes), FPZIP_TYPE_FLOAT, nx, ny, nz, 1);
+        fpz->threads = 1;
+        outbytes = (fpzip_write_header(fpz) ? fpzip_write(fpz, field) : 0);
+        status[i] = (outbytes != 0 && fpzip_errno == fpzipSuccess);
+        fpzip_write_close(fpz);
+        fpz = fpzip_read_from_mmap(buffer, outbytes);
+        status[i] &= (fpzip_read_header(fpz) && fpzip_read(fpz, copy) == outbytes && fpzip_errno == fpzipSuccess && !memcmp(copy, field, inbytes));
+        fpzip_read_close(fpz);
+        break;
+      case 1:
+        /* overflow output buffer */
+        fpz = setup_output(fpzip_write_to_buffer(buffer, 0x100), FPZIP_TYPE_FLOAT, nx, ny, nz, 1);
+        fpz->threads = 1;
+        status[i] = (fpzip_write_header(fpz) && !fpzip_write(fpz, field) && fpzip_errno == fpzipErrorBufferOverflow);
+        fpzip_write_close(fpz);
+        break;
+      default:
+        /* request unsupported precision */
+        fpz = setup_output(fpzip_write_to_buffer(buffer, bufbytes), FPZIP_TYPE_FLOAT, nx, ny, nz, 1);
+        fpz->prec = 33;
+        status[i] = (fpzip_write_header(fpz) && !fpzip_write(fpz, field) && fpzip_errno == fpzipErrorBadPrecision);
+        fpzip_write_close(fpz);
+        break;
+    }
+    free(copy);
+    free(buffer);
+  }
+
+  for (i = 0; i < n; i++)
+    success &= status[i];
+  success = test("test.float.concurrent", success);
+
+  free(status);
+  free(field);
+
+  return success;
+}
+
+/* compress and decompress arrays of varying layout and options using one
+   context and compare with streams that are not recycled */
+static int
+test_reuse(int nx, int ny, int nz)
+{
+  const struct {
+    int type, nx, nz, cz, prec, lanes, coder, model, bypass;
+  } config[] = {
+    { FPZIP_TYPE_FLOAT,  16, 16,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  16,  8,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  16, 16,  0, 20, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE, 16, 16,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  nx, nz,  0,  0, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,  nx, nz,  0,  0, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_STATIC,   1 },
+    { FPZIP_TYPE_DOUBLE, nx, nz,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  0 },
+    { FPZIP_TYPE_DOUBLE, nx, nz,  0, 48, 3, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC,   1 },
+    { FPZIP_TYPE_DOUBLE, nx, nz,  4,  0, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 0 },
+  };
+  const int nf = 2;
+  const int configs = (int)(sizeof(config) / sizeof(config[0]));
+  int success = 1;
+  int status;
+  int i, k;
+  size_t size = (size_t)nx * ny * nz * nf;
+  size_t inbytes = size * sizeof(double);
+  size_t bufbytes = 1024 + 2 * inbytes;
+  size_t outbytes;
+  double* dfield = double_field(nx, ny, nz * nf, 0);
+  float* ffield = float_field(nx, ny, nz * nf, 0);
+  void* buffer = malloc(bufbytes);
+  void* reference = malloc(bufbytes);
+  void* copy = malloc(inbytes);
+  void* expected = malloc(inbytes);
+  char name[0x100];
+  fpzip_context* ctx = fpzip_context_create();
+  FPZ* fpz;
+
+  /* visit each configuration twice so that state is both reused and replaced */
+  for (k = 0; k < 2 * configs; k++) {
+    const int c = k % configs;
+    const int type = config[c].type;
+    const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+    const void* field = (type == FPZIP_TYPE_FLOAT ? (const void*)ffield : (const void*)dfield);
+    const size_t bytes = (size_t)config[c].nx * ny * config[c].nz * nf * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+    size_t refbytes;
+
+    /* compress and decompress without context */
+    refbytes = compress_lanes(field, reference, bufbytes, type, config[c].nx, ny, config[c].nz, nf, 0, 0, config[c].cz, config[c].prec, config[c].lanes, config[c].coder, config[c].model, config[c].bypass);
+    fpz = fpzip_read_from_buffer(reference);
+    status = (refbytes != 0 && decompress(fpz, expected, bytes));
+    fpzip_read_close(fpz);
+
+    /* compress twice using context and compare with reference */
+    for (i = 0; i < 2 && status; i++) {
+      fpz = setup_output(fpzip_context_write_to_buffer(ctx, buffer, bufbytes), type, config[c].nx, ny, config[c].nz, nf);
+      fpz->cz = config[c].cz;
+      fpz->prec = config[c].prec;
+      fpz->lanes = config[c].lanes;
+      fpz->coder = config[c].coder;
+      fpz->model = config[c].model;
+      fpz->bypass = config[c].bypass;
+      outbytes = compress(fpz, field);
+      fpzip_write_close(fpz);
+      status = (outbytes == refbytes && !memcmp(buffer, reference, outbytes));
+    }
+    sprintf(name, "test.%s.reuse.compress.config%d", tname, k);
+    success &= test(name, status);
+
+    /* decompress twice using context */
+    for (i = 0; i < 2 && status; i++) {
+      fpz = fpzip_context_read_from_buffer(ctx, buffer);
+      status = (decompress(fpz, copy, bytes) && !memcmp(copy, expected, bytes));
+      fpzip_read_close(fpz);
+    }
+    sprintf(name, "test.%s.reuse.decompress.config%d", tname, k);
+    success &= test(name, status);
+  }
+
+  /* streams open at the same time are not shared */
+  fpz = fpzip_context_write_to_buffer(ctx, buffer, bufbytes);
+  status = (fpz != NULL);
+  if (status) {
+    FPZ* other = fpzip_context_write_to_buffer(ctx, reference, bufbytes);
+    status = (other != NULL && other != fpz);
+    if (other)
+      fpzip_write_close(other);
+    fpzip_write_close(fpz);
+  }
+  success &= test("test.reuse.concurrent", status);
+
+  fpzip_context_free(ctx);
+  free(expected);
+  free(copy);
+  free(reference);
+  free(buffer);
+  free(ffield);
+  free(dfield);
+
+  return success;
+}
+
+/* compress and decompress batches of small arrays of mixed layout */
+static int
+test_batch(int n)
+{
+  const struct {
+    int lanes, coder, model, bypass, predictor;
+  } config[] = {
+    { 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0, FPZIP_PREDICTOR_LORENZO },
+    { 4, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 1, FPZIP_PREDICTOR_LORENZO },
+    { 1, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC,   0, FPZIP_PREDICTOR_LORENZO },
+    { 2, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0, FPZIP_PREDICTOR_LORENZO },
+    { 1, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  0, FPZIP_PREDICTOR_LORENZO },
+    { 2, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 0, FPZIP_PREDICTOR_ADAPTIVE },
+  };
+  const int configs = (int)(sizeof(config) / sizeof(config[0]));
+  const int bx = 16, by = 16, bz = 16;
+  int success = 1;
+  int status;
+  int c, i;
+  size_t fsize = (size_t)bx * by * bz;
+  size_t dsize = (size_t)bx * by * 4 * 2;
+  size_t bufbytes = 1024 + 2 * n * fsize * sizeof(double);
+  float* ffield = float_field(bx, by, bz * n, 0);
+  double* dfield = double_field(bx, by, 4 * 2 * n, 0);
+  void* buffer = malloc(bufbytes);
+  void* single = malloc(bufbytes);
+  char* copy = malloc(n * fsize * sizeof(double));
+  fpzip_batch_item* item = malloc(n * sizeof(fpzip_batch_item));
+  fpzip_batch_item* meta = malloc(n * sizeof(fpzip_batch_item));
+  char name[0x100];
+  FPZ* fpz;
+
+  /* mostly float blocks of the same shape with some two-field double blocks */
+  memset(item, 0, n * sizeof(fpzip_batch_item));
+  for (i = 0; i < n; i++) {
+    FPZ* fpz = &item[i].fpz;
+    if (i % 7 == 3) {
+      fpz->type = FPZIP_TYPE_DOUBLE;
+      fpz->prec = (i % 14 == 3 ? 0 : 48);
+      fpz->nx = bx;
+      fpz->ny = by;
+      fpz->nz = 4;
+      fpz->nf = 2;
+      item[i].data = dfield + i * dsize;
+    }
+    else {
+      fpz->type = FPZIP_TYPE_FLOAT;
+      fpz->prec = 0;
+      fpz->nx = bx;
+      fpz->ny = by;
+      fpz->nz = bz;
+      fpz->nf = 1;
+      item[i].data = ffield + i * fsize;
+    }
+  }
+
+  for (c = 0; c < configs; c++) {
+    size_t outbytes, inbytes;
+    size_t offset = 0;
+    fpz = fpzip_write_to_buffer(buffer, bufbytes);
+    fpz->lanes = config[c].lanes;
+    fpz->coder = config[c].coder;
+    fpz->model = config[c].model;
+    fpz->bypass = config[c].bypass;
+    fpz->predictor = config[c].predictor;
+    /* follow batch by an ordinary array */
+    outbytes = fpzip_write_batch(fpz, item, n);
+    status = (outbytes != 0);
+    if (status) {
+      setup_output(fpz, FPZIP_TYPE_FLOAT, bx, by, bz, 1);
+      status = (fpzip_write_header(fpz) && fpzip_write(fpz, ffield) != 0);
+    }
+    fpzip_write_close(fpz);
+
+    /* decompress batch and the array that follows */
+    if (status) {
+      fpz = fpzip_read_from_buffer(buffer);
+      status = (fpzip_read_batch_header(fpz, NULL, 0) == n &&
+                fpzip_read_batch_header(fpz, meta, n) == n &&
+                (fpz->lanes > 1 ? fpz->lanes : 1) == config[c].lanes && fpz->model == config[c].model &&
+                fpz->predictor == config[c].predictor);
+      for (i = 0; i < n && status; i++) {
+        status = (meta[i].fpz.type == item[i].fpz.type && meta[i].fpz.prec == item[i].fpz.prec &&
+                  meta[i].fpz.nx == item[i].fpz.nx && meta[i].fpz.ny == item[i].fpz.ny &&
+                  meta[i].fpz.nz == item[i].fpz.nz && meta[i].fpz.nf == item[i].fpz.nf);
+        meta[i].data = copy + offset;
+        offset += (size_t)meta[i].fpz.nx * meta[i].fpz.ny * meta[i].fpz.nz * meta[i].fpz.nf * (meta[i].fpz.type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+      }
+      status = status && (fpzip_read_batch(fpz, meta, n) == outbytes);
+      /* arrays compressed losslessly must match */
+      for (i = 0; i < n && status; i++) {
+        if (!item[i].fpz.prec) {
+          size_t bytes = (size_t)item[i].fpz.nx * item[i].fpz.ny * item[i].fpz.nz * item[i].fpz.nf * (item[i].fpz.type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+          status = !memcmp(meta[i].data, item[i].data, bytes);
+        }
+      }
+      inbytes = bx * by * bz * sizeof(float);
+      status = status && decompress(fpz, copy, inbytes) && !memcmp(copy, ffield, inbytes);
+      fpzip_read_close(fpz);
+    }
+    sprintf(name, "test.batch.config%d", c);
+    success &= test(name, status);
+
+    /* for small arrays, a batch is smaller than separate streams */
+    if (c == 0) {
+      size_t total = 0;
+      for (i = 0; i < n && status; i++) {
+        size_t bytes;
+        fpz = fpzip_write_to_buffer(single, bufbytes);
+        *fpz = item[i].fpz;
+        bytes = compress(fpz, item[i].data);
+        fpzip_write_close(fpz);
+        status = (bytes != 0);
+        total += bytes;
+      }
+      success &= test("test.batch.compact", status && outbytes < total);
+    }
+  }
+
+  /* an ordinary header is not a batch header */
+  fpz = setup_output(fpzip_write_to_buffer(buffer, bufbytes), FPZIP_TYPE_FLOAT, bx, by, bz, 1);
+  status = (compress(fpz, ffield) != 0);
+  fpzip_write_close(fpz);
+  fpz = fpzip_read_from_buffer(buffer);
+  status = status && (fpzip_read_batch_header(fpz, NULL, 0) < 0 && fpzip_errno == fpzipErrorBadFormat);
+  status = status && (!fpzip_read_batch(fpz, meta, 0) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_read_close(fpz);
+  success &= test("test.batch.format", status);
+
+  free(meta);
+  free(item);
+  free(copy);
+  free(single);
+  free(buffer);
+  free(dfield);
+  free(ffield);
+
+  return success;
+}
+
+/* data that is smooth along x but has uncorrelated row offsets */
+static float*
+row_field(int nx, int ny, int nz)
+{
+  float* field = malloc((size_t)nx * ny * nz * sizeof(float));
+  unsigned int seed = 1;
+  int x, y, z;
+  for (z = 0; z < nz; z++)
+    for (y = 0; y < ny; y++) {
+      float offset;
+      seed = 1103515245 * seed + 12345;
+      offset = (float)((seed >> 16) & 0x7fffu) / 32;
+      for (x = 0; x < nx; x++)
+        field[x + nx * (y + ny * z)] = offset + (float)sin(0.05 * x + 0.3 * y + 0.7 * z);
+    }
+  return field;
+}
+
+static int
+test_predictor(int nx, int ny, int nz)
+{
+  const struct {
+    int type, cx, cy, cz, prec, lanes, coder, model, bypass;
+  } config[] = {
+    { FPZIP_TYPE_FLOAT,   0,  0,  0,  0, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_FLOAT,   0,  0,  0, 16, 1, FPZIP_CODER_RANGE, FPZIP_MODEL_STATIC,   0 },
+    { FPZIP_TYPE_FLOAT,  32, 20, 16,  0, 2, FPZIP_CODER_RANS,  FPZIP_MODEL_CONTEXT,  1 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 4, FPZIP_CODER_RANGE, FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0, 16, 40, 1, FPZIP_CODER_RANS,  FPZIP_MODEL_ADAPTIVE, 0 },
+    { FPZIP_TYPE_DOUBLE,  0,  0,  0,  0, 3, FPZIP_CODER_RANGE, FPZIP_MODEL_CONTEXT,  1 },
+  };
+  const int nf = 2;
+  const int configs = (int)(sizeof(config) / sizeof(config[0]));
+  int success = 1;
+  int status;
+  int i, k, p;
+  size_t j;
+  size_t size = (size_t)nx * ny * nz * nf;
+  size_t inbytes = size * sizeof(double);
+  size_t bufbytes = 1024 + inbytes;
+  size_t outbytes[2];
+  size_t bound;
+  void* buffer[2] = { malloc(bufbytes), malloc(bufbytes) };
+  void* copy = malloc(inbytes);
+  void* ref = malloc(inbytes);
+  float* ffield = float_field(nx, ny, nz * nf, 0);
+  double* dfield = double_field(nx, ny, nz * nf, 0);
+  float* rfield = row_field(nx, ny, nz * nf);
+  unsigned char* noise = malloc(inbytes);
+  unsigned int seed = 1;
+  char name[0x100];
+  FPZ* fpz;
+
+  /* fill arrays with random bits, which are incompressible */
+  for (j = 0; j < inbytes; j++) {
+    seed = 1103515245 * seed + 12345;
+    noise[j] = (unsigned char)(seed >> 16);
+  }
+
+  for (i = 0; i < configs; i++) {
+    const int type = config[i].type;
+    const char* tname = (type == FPZIP_TYPE_FLOAT ? "float" : "double");
+    const void* field = (type == FPZIP_TYPE_FLOAT ? (const void*)ffield : (const void*)dfield);
+    size_t bytes = size * (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
+
+    /* compress with Lorenzo (reference) and adaptive predictor */
+    for (p = 0; p < 2; p++) {
+      fpz = setup_output(fpzip_write_to_buffer(buffer[p], bufbytes), type, nx, ny, nz, nf);
+      fpz->cx = config[i].cx;
+      fpz->cy = config[i].cy;
+      fpz->cz = config[i].cz;
+      fpz->prec = config[i].prec;
+      fpz->lanes = config[i].lanes;
+      fpz->coder = config[i].coder;
+      fpz->model = config[i].model;
+      fpz->bypass = config[i].bypass;
+      fpz->predictor = p ? FPZIP_PREDICTOR_ADAPTIVE : FPZIP_PREDICTOR_LORENZO;
+      bound = fpzip_compress_bound(fpz);
+      outbytes[p] = compress(fpz, field);
+      fpzip_write_close(fpz);
+    }
+    status = (outbytes[0] != 0 && outbytes[1] != 0 && outbytes[1] <= bound);
+    /* incompressible data must fit in a buffer of exactly bound bytes */
+    if (status) {
+      void* tight = malloc(bound);
+      fpz = setup_output(fpzip_write_to_buffer(tight, bound), type, nx, ny, nz, nf);
+      fpz->cx = config[i].cx;
+      fpz->cy = config[i].cy;
+      fpz->cz = config[i].cz;
+      fpz->prec = config[i].prec;
+      fpz->lanes = config[i].lanes;
+      fpz->coder = config[i].coder;
+      fpz->model = config[i].model;
+      fpz->bypass = config[i].bypass;
+      fpz->predictor = FPZIP_PREDICTOR_ADAPTIVE;
+      status = (compress(fpz, noise) != 0);
+      fpzip_write_close(fpz);
+      free(tight);
+    }
+    sprintf(name, "test.%s.predictor.config%d.compress", tname, i);
+    success &= test(name, status);
+    if (!status)
+      continue;
+
+    /* decompress reference */
+    fpz = fpzip_read_from_buffer(buffer[0]);
+    status = decompress(fpz, ref, bytes);
+    fpzip_read_close(fpz);
+
+    /* decompress and compare with reference */
+    fpz = fpzip_read_from_buffer(buffer[1]);
+    status = status && decompress(fpz, copy, bytes) && fpz->predictor == FPZIP_PREDICTOR_ADAPTIVE && !memcmp(copy, ref, bytes);
+    fpzip_read_close(fpz);
+    sprintf(name, "test.%s.predictor.config%d.decompress", tname, i);
+    success &= test(name, status);
+
+    /* decompress one slice at a time */
+    if (config[i].cx || config[i].cy || config[i].cz)
+      continue;
+    fpz = fpzip_read_from_buffer(buffer[1]);
+    status = status && fpzip_read_header(fpz);
+    for (k = 0; k < nz * nf && status; k++)
+      status = (fpzip_read_slices(fpz, copy, 1) != 0 && !memcmp(copy, (const char*)ref + k * (bytes / (nz * nf)), bytes / (nz * nf)));
+    fpzip_read_close(fpz);
+    sprintf(name, "test.%s.predictor.config%d.slices", tname, i);
+    success &= test(name, status);
+  }
+
+  /* adaptive prediction must pay off on rows with uncorrelated offsets */
+  for (p = 0; p < 2; p++) {
+    fpz = setup_output(fpzip_write_to_buffer(buffer[p], bufbytes), FPZIP_TYPE_FLOAT, nx, ny, nz, nf);
+    fpz->predictor = p ? FPZIP_PREDICTOR_ADAPTIVE : FPZIP_PREDICTOR_LORENZO;
+    outbytes[p] = compress(fpz, rfield);
+    fpzip_write_close(fpz);
+  }
+  fpz = fpzip_read_from_buffer(buffer[1]);
+  status = (outbytes[0] != 0 && outbytes[1] != 0 && outbytes[1] < outbytes[0] && decompress(fpz, copy, size * sizeof(float)) && !memcmp(copy, rfield, size * sizeof(float)));
+  fpzip_read_close(fpz);
+  success &= test("test.float.predictor.rows", status);
+
+  /* make sure invalid predictor is rejected */
+  fpz = setup_output(fpzip_write_to_buffer(buffer[0], bufbytes), FPZIP_TYPE_FLOAT, nx, ny, nz, nf);
+  fpz->predictor = 2;
+  status = (!fpzip_write_header(fpz) && fpzip_errno == fpzipErrorBadArgument);
+  fpzip_write_close(fpz);
+  success &= test("test.float.predictor.invalid", status);
+
+  free(noise);
+  free(rfield);
+  free(dfield);
+  free(ffield);
+  free(ref);
+  free(copy);
+  free(buffer[1]);
+  free(buffer[0]);
+
+  return success;
+}
+
 static int
 init()
 {
@@ -408,16 +1807,175 @@ init()
   return 1;
 }
 
-int main()
+/* meta data of arrays with dimensions beyond 32 bits */
+static int
+test_wide(void)
+{
+  const size_t n = (size_t)-1 >> 16;
+  int success = 1;
+  int status;
+  unsigned char buffer[0x100];
+  FPZ* fpz;
+
+  /* on 64-bit platforms, wide dimensions call for a 64-bit header */
+  if (sizeof(size_t) > 4) {
+    fpz = setup_output(fpzip_write_to_buffer(buffer, sizeof(buffer)), FPZIP_TYPE_DOUBLE, 1, 3, 1, 2);
+    fpz->nx = n;
+    fpz->nz = n - 1;
+    status = fpzip_write_header(fpz) && fpzip_compress_bound(fpz) > n;
+    fpzip_write_close(fpz);
+    fpz = fpzip_read_from_buffer(buffer);
+    status = status && fpzip_read_header(fpz) && fpz->type == FPZIP_TYPE_DOUBLE &&
+             fpz->nx == n && fpz->ny == 3 && fpz->nz == n - 1 && fpz->nf == 2;
+    fpzip_read_close(fpz);
+    success &= test("test.header.wide", status);
+  }
+
+  /* largest dimensions that fit in the original header */
+  fpz = setup_output(fpzip_write_to_buffer(buffer, sizeof(buffer)), FPZIP_TYPE_FLOAT, 1, 1, 1, 1);
+  fpz->nx = 0xffffffffu;
+  status = fpzip_write_header(fpz);
+  fpzip_write_close(fpz);
+  fpz = fpzip_read_from_buffer(buffer);
+  status = status && fpzip_read_header(fpz) && fpz->nx == 0xffffffffu && fpz->ny == 1;
+  fpzip_read_close(fpz);
+  success &= test("test.header.narrow", status);
+
+  return success;
+}
+
+/* allocate zero-initialized memory that, where supported, is backed by
+   physical memory only once written */
+static void*
+sparse_alloc(size_t bytes)
+{
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+  void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return p == MAP_FAILED ? NULL : p;
+#else
+  return calloc(bytes, 1);
+#endif
+}
+
+static void
+sparse_free(void* p, size_t bytes)
+{
+#if defined(MAP_ANONYMOUS) && defined(MAP_NORESERVE)
+  if (p)
+    munmap(p, bytes);
+#else
+  (void)bytes;
+  free(p);
+#endif
+}
+
+/* compress array of more than 2^32 samples at once and a slice at a time,
+   and decompress it a slice at a time; only the first row of each slice is
+   nonzero so that the array need not be backed by memory as a whole */
+static int
+test_large(size_t nx, size_t ny, size_t nz, size_t nf)
+{
+  int success = 1;
+  int status;
+  size_t size = nx * ny;
+  size_t slices = nz * nf;
+  size_t inbytes = size * slices * sizeof(float);
+  size_t bytes = 0;
+  size_t oneshot_bytes = 0;
+  size_t read = 0;
+  size_t i, k;
+  float* slice = calloc(size, sizeof(float));
+  float* field = sparse_alloc(inbytes);
+  void* oneshot = NULL;
+  void* memory = NULL;
+  FPZ* fpz;
+
+  /* compress whole array with one call */
+  status = (field != NULL);
+  for (k = 0; status && k < slices; k++)
+    for (i = 0; i < nx; i++)
+      field[k * size + i] = (float)k;
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_FLOAT, (int)nx, (int)ny, (int)nz, (int)nf);
+  status = status && fpzip_write_header(fpz) && fpzip_write(fpz, field);
+  oneshot = fpzip_write_close_memory(fpz, &oneshot_bytes);
+  status = status && oneshot;
+  sparse_free(field, inbytes);
+  success &= test("test.float.large.compress", status);
+
+  /* compress a slice at a time and compare with one-shot compression */
+  fpz = setup_output(fpzip_write_to_memory(), FPZIP_TYPE_FLOAT, (int)nx, (int)ny, (int)nz, (int)nf);
+  status = slice && fpzip_write_header(fpz) && fpzip_write_begin(fpz);
+  for (k = 0; status && k < slices; k++) {
+    for (i = 0; i < nx; i++)
+      slice[i] = (float)k;
+    status = fpzip_write_slices(fpz, slice, 1);
+  }
+  if (status)
+    bytes = fpzip_write_end(fpz);
+  memory = fpzip_write_close_memory(fpz, &size);
+  status = status && bytes && memory && oneshot && bytes == oneshot_bytes && !memcmp(memory, oneshot, bytes);
+  success &= test("test.float.large.slices", status);
+
+  /* decompress a slice at a time and validate */
+  if (status) {
+    fpz = fpzip_read_from_buffer(memory);
+    status = fpzip_read_header(fpz) && fpz->nx == nx && fpz->ny == ny && fpz->nz == nz && fpz->nf == nf;
+    size = nx * ny;
+    for (k = 0; status && k < slices; k++) {
+      read = fpzip_read_slices(fpz, slice, 1);
+      status = (read != 0);
+      for (i = 0; status && i < size; i++)
+        status = (slice[i] == (i < nx ? (float)k : 0.0f));
+    }
+    status = status && read == bytes;
+    fpzip_read_close(fpz);
+    success &= test("test.float.large.decompress", status);
+  }
+
+  free(memory);
+  free(oneshot);
+  free(slice);
+  return success;
+}
+
+int main(int argc, char* argv[])
 {
   int success = 1;
   const int nx = 65;
   const int ny = 64;
   const int nz = 63;
 
-  if (init()) {
+  if (argc > 1 && !strcmp(argv[1], "large")) {
+    if (sizeof(size_t) < 8)
+      fprintf(stderr, "arrays of more than 2^32 samples are not addressable; skipping\n");
+    else {
+      /* 4096 * 4096 * 129 * 2 > 2^32 samples, with fields more than 2^31 samples apart */
+      success &= test_large(4096, 4096, 129, 2);
+    }
+    fprintf(stderr, "\n");
+  }
+  else if (init()) {
     success &= test_float(nx, ny, nz);
     success &= test_double(nx, ny, nz);
+    success &= test_chunked(nx, ny, nz);
+    success &= test_fields(nx, ny, 8, 3);
+    success &= test_subvolume(nx, ny, 10, 2);
+    success &= test_pipelined(nx, ny, nz);
+    success &= test_lanes(nx, ny, 16);
+    success &= test_rans(nx, ny, 16);
+    success &= test_static(nx, ny, 16);
+    success &= test_context(nx, ny, 16);
+    success &= test_bypass(nx, ny, 16);
+    success &= test_path(nx, ny, nz);
+    success &= test_callback(nx, ny, 16);
+    success &= test_bound(nx, ny, 16);
+    success &= test_slices(nx, ny, 16);
+    success &= test_read_slices(nx, ny, 16);
+    success &= test_threads(nx, ny, 16);
+    success &= test_reuse(nx, ny, 16);
+    success &= test_batch(64);
+    success &= test_predictor(nx, ny, 16);
+    success &= test_wide();
     fprintf(stderr, "\n");
   }
   else
@@ -20,6 +20,14 @@ usage()
   fprintf(stderr, "  -2 <nx> <ny> : dimensions of 2D array a[ny][nx]\n");
   fprintf(stderr, "  -3 <nx> <ny> <nz> : dimensions of 3D array a[nz][ny][nx]\n");
   fprintf(stderr, "  -4 <nx> <ny> <nz> <nf> : dimensions of multi-field 3D array a[nf][nz][ny][nx]\n");
+  fprintf(stderr, "  -c <cx> <cy> <cz> : chunk dimensions; zero = full extent (default=unchunked)\n");
+  fprintf(stderr, "  -l <lanes> : number of entropy coder lanes (default=1)\n");
+  fprintf(stderr, "  -e <range|rans> : entropy coder (default=range)\n");
+  fprintf(stderr, "  -m <adaptive|static|context> : probability model (default=adaptive)\n");
+  fprintf(stderr, "  -b : store low bits of residuals uncoded\n");
+  fprintf(stderr, "  -a : select predictor per row (default=3D Lorenzo)\n");
+  fprintf(stderr, "  -n <threads> : number of threads for chunked streams (default=all)\n");
+  fprintf(stderr, "  -f <field> : decompress only given field (default=all)\n");
   return EXIT_FAILURE;
 }
 
@@ -27,10 +35,20 @@ int main(int argc, char* argv[])
 {
   int type = FPZIP_TYPE_FLOAT;
   int prec = 0;
-  int nx = 1;
-  int ny = 1;
-  int nz = 1;
-  int nf = 1;
+  unsigned long nx = 1;
+  unsigned long ny = 1;
+  unsigned long nz = 1;
+  unsigned long nf = 1;
+  int cx = 0;
+  int cy = 0;
+  int cz = 0;
+  int lanes = 0;
+  int coder = FPZIP_CODER_RANGE;
+  int model = FPZIP_MODEL_ADAPTIVE;
+  int bypass = 0;
+  int predictor = FPZIP_PREDICTOR_LORENZO;
+  int threads = 0;
+  int field = -1;
   char* inpath= 0;
   char* outpath = 0;
   bool zip = true;
@@ -46,6 +64,10 @@ int main(int argc, char* argv[])
       zip = false;
     else if (!strcmp(argv[i], "-q"))
       quiet = true;
+    else if (!strcmp(argv[i], "-b"))
+      bypass = 1;
+    else if (!strcmp(argv[i], "-a"))
+      predictor = FPZIP_PREDICTOR_ADAPTIVE;
     else if (!strcmp(argv[i], "-i")) {
       if (++i == argc)
         return usage();
@@ -71,28 +93,68 @@ int main(int argc, char* argv[])
         return usage();
     }
     else if (!strcmp(argv[i], "-1")) {
-      if (++i == argc || sscanf(argv[i], "%d", &nx) != 1)
+      if (++i == argc || sscanf(argv[i], "%lu", &nx) != 1)
         return usage();
       ny = nz = nf = 1;
     }
     else if (!strcmp(argv[i], "-2")) {
-      if (++i == argc || sscanf(argv[i], "%d", &nx) != 1 ||
-          ++i == argc || sscanf(argv[i], "%d", &ny) != 1)
+      if (++i == argc || sscanf(argv[i], "%lu", &nx) != 1 ||
+          ++i == argc || sscanf(argv[i], "%lu", &ny) != 1)
         return usage();
       nz = nf = 1;
     }
     else if (!strcmp(argv[i], "-3")) {
-      if (++i == argc || sscanf(argv[i], "%d", &nx) != 1 ||
-          ++i == argc || sscanf(argv[i], "%d", &ny) != 1 ||
-          ++i == argc || sscanf(argv[i], "%d", &nz) != 1)
+      if (++i == argc || sscanf(argv[i], "%lu", &nx) != 1 ||
+          ++i == argc || sscanf(argv[i], "%lu", &ny) != 1 ||
+          ++i == argc || sscanf(argv[i], "%lu", &nz) != 1)
         return usage();
       nf = 1;
     }
     else if (!strcmp(argv[i], "-4")) {
-      if (++i == argc || sscanf(argv[i], "%d", &nx) != 1 ||
-          ++i == argc || sscanf(argv[i], "%d", &ny) != 1 ||
-          ++i == argc || sscanf(argv[i], "%d", &nz) != 1 ||
-          ++i == argc || sscanf(argv[i], "%d", &nf) != 1)
+      if (++i == argc || sscanf(argv[i], "%lu", &nx) != 1 ||
+          ++i == argc || sscanf(argv[i], "%lu", &ny) != 1 ||
+          ++i == argc || sscanf(argv[i], "%lu", &nz) != 1 ||
+          ++i == argc || sscanf(argv[i], "%lu", &nf) != 1)
+        return usage();
+    }
+    else if (!strcmp(argv[i], "-c")) {
+      if (++i == argc || sscanf(argv[i], "%d", &cx) != 1 ||
+          ++i == argc || sscanf(argv[i], "%d", &cy) != 1 ||
+          ++i == argc || sscanf(argv[i], "%d", &cz) != 1)
+        return usage();
+    }
+    else if (!strcmp(argv[i], "-l")) {
+      if (++i == argc || sscanf(argv[i], "%d", &lanes) != 1)
+        return usage();
+    }
+    else if (!strcmp(argv[i], "-e")) {
+      if (++i == argc)
+        return usage();
+      if (!strcmp(argv[i], "range"))
+        coder = FPZIP_CODER_RANGE;
+      else if (!strcmp(argv[i], "rans"))
+        coder = FPZIP_CODER_RANS;
+      else
+        return usage();
+    }
+    else if (!strcmp(argv[i], "-m")) {
+      if (++i == argc)
+        return usage();
+      if (!strcmp(argv[i], "adaptive"))
+        model = FPZIP_MODEL_ADAPTIVE;
+      else if (!strcmp(argv[i], "static"))
+        model = FPZIP_MODEL_STATIC;
+      else if (!strcmp(argv[i], "context"))
+        model = FPZIP_MODEL_CONTEXT;
+      else
+        return usage();
+    }
+    else if (!strcmp(argv[i], "-n")) {
+      if (++i == argc || sscanf(argv[i], "%d", &threads) != 1)
+        return usage();
+    }
+    else if (!strcmp(argv[i], "-f")) {
+      if (++i == argc || sscanf(argv[i], "%d", &field) != 1)
         return usage();
     }
 
@@ -138,6 +200,15 @@ int main(int argc, char* argv[])
     fpz->ny = ny;
     fpz->nz = nz;
     fpz->nf = nf;
+    fpz->cx = cx;
+    fpz->cy = cy;
+    fpz->cz = cz;
+    fpz->lanes = lanes;
+    fpz->coder = coder;
+    fpz->model = model;
+    fpz->bypass = bypass;
+    fpz->predictor = predictor;
+    fpz->threads = threads;
     // write header
     if (!fpzip_write_header(fpz)) {
       fprintf(stderr, "cannot write header: %s\n", fpzip_errstr[fpzip_errno]);
@@ -155,13 +226,13 @@ int main(int argc, char* argv[])
       fprintf(stderr, "outbytes=%lu ratio=%.2f\n", (unsigned long)outbytes, double(nx) * ny * nz * nf * size / outbytes);
   }
   else {
-    // decompress from file
-    FILE* file = inpath ? fopen(inpath, "rb") : stdin;
-    if (!file) {
+    // decompress from file, mapped into memory if given by path
+    FPZ* fpz = inpath ? fpzip_read_from_path(inpath) : fpzip_read_from_file(stdin);
+    if (!fpz) {
       fprintf(stderr, "cannot open input file\n");
       return EXIT_FAILURE;
     }
-    FPZ* fpz = fpzip_read_from_file(file);
+    fpz->threads = threads;
     // read header
     if (!fpzip_read_header(fpz)) {
       fprintf(stderr, "cannot read header: %s\n", fpzip_errstr[fpzip_errno]);
@@ -174,21 +245,20 @@ int main(int argc, char* argv[])
     nz = fpz->nz;
     nf = fpz->nf;
     if (!quiet)
-      fprintf(stderr, "type=%s nx=%d ny=%d nz=%d nf=%d prec=%d\n", type == FPZIP_TYPE_FLOAT ? "float" : "double", nx, ny, nz, nf, prec);
+      fprintf(stderr, "type=%s nx=%lu ny=%lu nz=%lu nf=%lu prec=%d\n", type == FPZIP_TYPE_FLOAT ? "float" : "double", nx, ny, nz, nf, prec);
 
-    size_t count = (size_t)nx * ny * nz * nf;
+    size_t count = (size_t)nx * ny * nz * (field < 0 ? nf : 1);
     size_t size = (type == FPZIP_TYPE_FLOAT ? sizeof(float) : sizeof(double));
     data = (type == FPZIP_TYPE_FLOAT ? static_cast<void*>(new float[count]) : static_cast<void*>(new double[count]));
     // perform actual decompression
-    if (!fpzip_read(fpz, data)) {
+    if (!(field < 0 ? fpzip_read(fpz, data) : fpzip_read_field(fpz, (size_t)field, data))) {
       fprintf(stderr, "decompression failed: %s\n", fpzip_errstr[fpzip_errno]);
       return EXIT_FAILURE;
     }
     fpzip_read_close(fpz);
-    fclose(file);
 
     // write decompressed data to file
-    file = outpath ? fopen(outpath, "wb") : stdout;
+    FILE* file = outpath ? fopen(outpath, "wb") : stdout;
     if (!file) {
       fprintf(stderr, "cannot create output file\n");
       return EXIT_FAILURE;